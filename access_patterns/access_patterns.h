@@ -0,0 +1,259 @@
+// -*- c++ -*-
+
+#ifndef _AMSTEL_ACCESS_PATTERNS_H
+#define _AMSTEL_ACCESS_PATTERNS_H
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <cstdint>
+#include <cmath>
+
+/*
+ Streams of keys in the grid {0,...,N-1}^D, for benchmarking containers with
+ other access patterns than the row-major loops over (j,k) or (j,k,l):
+ 1) sequential: row-major order, the last coordinate running fastest;
+ 2) uniform: independent, uniformly distributed keys;
+ 3) zipf: keys drawn with probability proportional to 1/rank, where the
+    ranks are assigned to the grid points by a random permutation, so that
+    a few scattered keys are hot;
+ 4) level_ordered: coarse-to-fine, i.e., first the points whose coordinates
+    are multiples of 2^L (L=ceil(log2(N))), then the new points on the grid
+    with step size 2^{L-1}, and so on, as in a multilevel traversal;
+ 5) tree_refinement: the corners of the dyadic cells, visited depth-first,
+    of an adaptive refinement towards a random point, where a cell is
+    refined if its center is not farther away from the point than its size;
+    every corner is visited once per refinement, not once per level;
+ 6) stencil: every point in row-major order, followed by its 2*D neighbours
+    (as far as they exist), as in a matrix-vector product with a stencil.
+ Every stream has the requested length M; the deterministic patterns start
+ over when they are exhausted. The random patterns only use the raw output of
+ std::mt19937_64, which is specified by the standard, so that the same seed
+ yields the same stream with every standard library.
+ All container benchmarks in map_tuple_keys read their maps with all six
+ patterns and the default seed (most of them via for_each_pattern()), and
+ time the reads in the benchmark harness. This excludes test_map_codes.cpp and
+ test_map_unrank.cpp, which time the encoding of keys in row-major order
+ and the traversal of a map in its own order, but no lookups of keys.
+ */
+
+namespace access_patterns
+{
+  enum class Pattern
+  {
+    sequential,
+    uniform,
+    zipf,
+    level_ordered,
+    tree_refinement,
+    stencil
+  };
+
+  constexpr Pattern all_patterns[] =
+  {
+    Pattern::sequential, Pattern::uniform, Pattern::zipf,
+    Pattern::level_ordered, Pattern::tree_refinement, Pattern::stencil
+  };
+
+  // the seed used by all benchmarks, unless they choose another one
+  constexpr uint64_t default_seed = 20230301;
+
+  inline const char* name(const Pattern pattern)
+  {
+    switch (pattern)
+    {
+    case Pattern::sequential: return "sequential";
+    case Pattern::uniform: return "uniform";
+    case Pattern::zipf: return "zipf";
+    case Pattern::level_ordered: return "level-ordered";
+    case Pattern::tree_refinement: return "tree refinement";
+    case Pattern::stencil: return "stencil";
+    }
+    return "";
+  }
+
+  template <unsigned int D>
+  using Point = std::array<int,D>;
+
+  template <unsigned int D>
+  using Stream = std::vector<Point<D> >;
+
+  // the point with row-major number i
+  template <unsigned int D>
+  Point<D> point(uint64_t i, const int N)
+  {
+    Point<D> p;
+    for (int d = D-1; d >= 0; d--)
+    {
+      p[d] = i % N;
+      i /= N;
+    }
+    return p;
+  }
+
+  template <unsigned int D>
+  uint64_t grid_size(const int N)
+  {
+    uint64_t r(1);
+    for (unsigned int d = 0; d < D; d++)
+      r *= N;
+    return r;
+  }
+
+  // uniformly distributed in [0,1)
+  inline double uniform01(std::mt19937_64& generator)
+  {
+    return (generator() >> 11) * 0x1.0p-53;
+  }
+
+  /*
+   Append the corners of the subcells of the dyadic cell of size size at
+   corner, if it is refined towards x, and recursively of their subcells.
+   The first subcell shares its corner with the cell, which has already been
+   appended by the caller, so that every corner is appended only once.
+   */
+  template <unsigned int D>
+  void refine(const Point<D>& corner, const int size, const std::array<double,D>& x,
+              const int N, const size_t M, Stream<D>& keys)
+  {
+    if (keys.size() >= M || size == 1)
+      return;
+    double distance(0);
+    for (unsigned int d = 0; d < D; d++)
+      distance = std::max(distance, std::abs(corner[d]+0.5*size-x[d]));
+    if (distance > size)
+      return;
+    for (unsigned int c = 0; c < (1u << D); c++)
+    {
+      Point<D> child(corner);
+      bool inside(true);
+      for (unsigned int d = 0; d < D; d++)
+      {
+        if (c & (1u << d))
+          child[d] += size/2;
+        inside = inside && child[d] < N;
+      }
+      if (inside)
+      {
+        if (c > 0 && keys.size() < M)
+          keys.push_back(child);
+        refine<D>(child, size/2, x, N, M, keys);
+      }
+    }
+  }
+
+  // M keys in {0,...,N-1}^D with the given pattern
+  template <unsigned int D>
+  Stream<D> generate(const Pattern pattern, const int N, const size_t M,
+                     const uint64_t seed = default_seed)
+  {
+    Stream<D> keys;
+    keys.reserve(M);
+    std::mt19937_64 generator(seed);
+    const uint64_t K(grid_size<D>(N));
+
+    switch (pattern)
+    {
+    case Pattern::sequential:
+      for (size_t i = 0; i < M; i++)
+        keys.push_back(point<D>(i % K, N));
+      break;
+
+    case Pattern::uniform:
+      for (size_t i = 0; i < M; i++)
+        keys.push_back(point<D>(generator() % K, N));
+      break;
+
+    case Pattern::zipf:
+    {
+      // the cumulative weights of the ranks 1,...,K, and a random assignment of the ranks
+      std::vector<double> cdf(K);
+      double sum(0);
+      for (uint64_t r = 0; r < K; r++)
+        cdf[r] = (sum += 1.0/(r+1));
+      std::vector<uint64_t> permutation(K);
+      for (uint64_t r = 0; r < K; r++)
+        permutation[r] = r;
+      for (uint64_t r = K-1; r > 0; r--)
+        std::swap(permutation[r], permutation[generator() % (r+1)]);
+      for (size_t i = 0; i < M; i++)
+      {
+        const uint64_t r(std::upper_bound(cdf.begin(), cdf.end(), uniform01(generator)*sum) - cdf.begin());
+        keys.push_back(point<D>(permutation[std::min(r, K-1)], N));
+      }
+      break;
+    }
+
+    case Pattern::level_ordered:
+    {
+      int L(0);
+      while ((1 << L) < N)
+        L++;
+      while (keys.size() < M)
+        for (int l = 0; l <= L && keys.size() < M; l++)
+        {
+          const int step(1 << (L-l));
+          const int n((N+step-1)/step); // points per direction on this level
+          for (uint64_t i = 0; i < grid_size<D>(n) && keys.size() < M; i++)
+          {
+            Point<D> p(point<D>(i, n));
+            bool coarse(l > 0);
+            for (unsigned int d = 0; d < D; d++)
+            {
+              coarse = coarse && p[d] % 2 == 0;
+              p[d] *= step;
+            }
+            if (!coarse)
+              keys.push_back(p);
+          }
+        }
+      break;
+    }
+
+    case Pattern::tree_refinement:
+    {
+      int size(1);
+      while (size < N)
+        size *= 2;
+      while (keys.size() < M)
+      {
+        std::array<double,D> x;
+        for (unsigned int d = 0; d < D; d++)
+          x[d] = uniform01(generator)*N;
+        keys.push_back(Point<D>{});
+        refine<D>(Point<D>{}, size, x, N, M, keys);
+      }
+      break;
+    }
+
+    case Pattern::stencil:
+      for (uint64_t i = 0; keys.size() < M; i = (i+1) % K)
+      {
+        const Point<D> p(point<D>(i, N));
+        keys.push_back(p);
+        for (unsigned int d = 0; d < D; d++)
+          for (int delta = -1; delta <= 1; delta += 2)
+            if (p[d]+delta >= 0 && p[d]+delta < N && keys.size() < M)
+            {
+              Point<D> q(p);
+              q[d] += delta;
+              keys.push_back(q);
+            }
+      }
+      break;
+    }
+
+    return keys;
+  }
+
+  // call f(pattern, keys) for the streams of M keys with all patterns, in the order of all_patterns
+  template <unsigned int D, class F>
+  void for_each_pattern(const int N, const size_t M, F&& f, const uint64_t seed = default_seed)
+  {
+    for (const Pattern pattern : all_patterns)
+      f(pattern, generate<D>(pattern, N, M, seed));
+  }
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <set>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include "access_patterns/access_patterns.h"
+
+/*
+ In this design test program, we check the key streams of access_patterns.h
+ (all keys lie in the grid, equal seeds give equal streams, the level-ordered
+ traversal and a single refinement tree visit every point exactly once) and
+ print some statistics of each pattern: the number of distinct keys, the
+ share of the 1% most frequent keys, and the mean distance between
+ consecutive keys, which indicates how local the accesses are.
+ */
+
+using std::cout;
+using std::endl;
+
+using namespace access_patterns;
+
+template <unsigned int D>
+void statistics(const int N, const size_t M)
+{
+  cout << "- D=" << D << ", N=" << N << ", " << M << " keys:" << endl;
+  for (const Pattern pattern : all_patterns)
+  {
+    const std::vector<Point<D> > keys(generate<D>(pattern, N, M));
+    std::map<Point<D>,size_t> counts;
+    double distance(0);
+    for (size_t i=0; i<keys.size(); i++)
+    {
+      counts[keys[i]]++;
+      if (i > 0)
+        for (unsigned int d=0; d<D; d++)
+          distance += std::abs(keys[i][d]-keys[i-1][d]);
+    }
+    std::vector<size_t> frequencies;
+    for (const auto& entry : counts)
+      frequencies.push_back(entry.second);
+    std::sort(frequencies.rbegin(), frequencies.rend());
+    size_t top(0);
+    for (size_t i=0; i<std::max<size_t>(1, grid_size<D>(N)/100) && i<frequencies.size(); i++)
+      top += frequencies[i];
+    cout << "  " << name(pattern) << ": " << counts.size() << " distinct keys, "
+      << 100.0*top/keys.size() << "% on the top 1%, mean distance " << distance/(keys.size()-1) << endl;
+  }
+}
+
+int main()
+{
+  const int N=100;
+  const size_t M=100000;
+
+  bool ok(true);
+  for (const Pattern pattern : all_patterns)
+  {
+    const std::vector<Point<2> > keys(generate<2>(pattern, N, M)), again(generate<2>(pattern, N, M));
+    const std::vector<Point<3> > keys3(generate<3>(pattern, 20, M));
+    ok = ok && keys.size() == M && keys3.size() == M && keys == again;
+    for (size_t i=0; i<M; i++)
+      ok = ok && keys[i][0] >= 0 && keys[i][0] < N && keys[i][1] >= 0 && keys[i][1] < N
+        && *std::min_element(keys3[i].begin(), keys3[i].end()) >= 0
+        && *std::max_element(keys3[i].begin(), keys3[i].end()) < 20;
+  }
+  cout << "- do all patterns give M keys in the grid, the same for the same seed? " << (ok ? "yes" : "no") << endl;
+  cout << "- do other seeds give other random streams? "
+    << (generate<2>(Pattern::uniform, N, M, 1) != generate<2>(Pattern::uniform, N, M, 2)
+        && generate<2>(Pattern::zipf, N, M, 1) != generate<2>(Pattern::zipf, N, M, 2) ? "yes" : "no") << endl;
+
+  const std::vector<Point<3> > levels(generate<3>(Pattern::level_ordered, 37, 37*37*37));
+  cout << "- does the level-ordered traversal visit every point once? "
+    << (std::set<Point<3> >(levels.begin(), levels.end()).size() == levels.size() ? "yes" : "no") << endl;
+
+  // a single refinement tree towards the center of the grid
+  std::vector<Point<2> > tree(1, Point<2>{});
+  refine<2>(Point<2>{}, 128, {50.5, 50.5}, N, M, tree);
+  cout << "- does the tree refinement visit each of its " << tree.size() << " corners once? "
+    << (std::set<Point<2> >(tree.begin(), tree.end()).size() == tree.size() ? "yes" : "no") << endl;
+
+  cout << endl;
+  statistics<2>(N, M);
+  statistics<3>(30, M);
+
+  return 0;
+}
@@ -0,0 +1,204 @@
+// -*- c++ -*-
+
+#ifndef _AMSTEL_BENCHMARK_HARNESS_H
+#define _AMSTEL_BENCHMARK_HARNESS_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ A small benchmark harness for the design test programs. So far, most of them
+ time a single run of each experiment with clock(), without warm-up, and the
+ compiler may drop loops whose results are never used.
+
+ Harness::run(name, items, f) calls f() warmup times without timing, then
+ repetitions times, each timed with std::chrono::steady_clock, and reports
+ the median, the 10% and 90% percentiles and the minimum of the samples.
+ The variant run(name, items, setup, f) calls setup() before every call of
+ f(), outside of the timed interval, e.g., to clear a container that f()
+ fills. Results which the benchmarked code computes should be passed to
+ do_not_optimize(), which forces the compiler to materialize them.
+
+ The number of repetitions and warm-up runs (10 and 1, unless the program
+ chooses other defaults) can be changed on the command line with
+ --repetitions=N and --warmup=N; with --json=FILE, all results are
+ additionally written to FILE in JSON format.
+ */
+
+namespace benchmark
+{
+  // force the compiler to compute value (and keep it in a register or in memory)
+  template <class T>
+  inline void do_not_optimize(const T& value)
+  {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+
+  template <class T>
+  inline void do_not_optimize(T& value)
+  {
+    asm volatile("" : "+r,m"(value) : : "memory");
+  }
+
+  // force the compiler to perform all pending writes to memory
+  inline void clobber_memory()
+  {
+    asm volatile("" : : : "memory");
+  }
+
+  // the p-quantile (0<=p<=1) of sorted samples, interpolating linearly
+  inline double percentile(const std::vector<double>& sorted, const double p)
+  {
+    if (sorted.empty())
+      return 0;
+    const double position(p*(sorted.size()-1));
+    const size_t lower(position);
+    if (lower+1 >= sorted.size())
+      return sorted.back();
+    return sorted[lower] + (position-lower)*(sorted[lower+1]-sorted[lower]);
+  }
+
+  struct Result
+  {
+    std::string name;
+    size_t items;             // number of operations per call, for the time per item
+    std::vector<double> seconds; // all samples, sorted
+
+    double median() const
+    {
+      return percentile(seconds, 0.5);
+    }
+
+    double minimum() const
+    {
+      return seconds.empty() ? 0 : seconds.front();
+    }
+  };
+
+  class Harness
+  {
+  public:
+    Harness(const std::string& suite, int argc = 0, char** argv = nullptr,
+            const int repetitions = 10, const int warmup = 1)
+    : suite_(suite), warmup_(warmup), repetitions_(repetitions)
+    {
+      for (int i = 1; i < argc; i++)
+      {
+        if (std::strncmp(argv[i], "--repetitions=", 14) == 0)
+          repetitions_ = std::max(1, std::atoi(argv[i]+14));
+        else if (std::strncmp(argv[i], "--warmup=", 9) == 0)
+          warmup_ = std::max(0, std::atoi(argv[i]+9));
+        else if (std::strncmp(argv[i], "--json=", 7) == 0)
+          json_file_ = argv[i]+7;
+      }
+    }
+
+    ~Harness()
+    {
+      if (!json_file_.empty())
+      {
+        std::ofstream file(json_file_);
+        write_json(file);
+      }
+    }
+
+    int warmup() const
+    {
+      return warmup_;
+    }
+
+    int repetitions() const
+    {
+      return repetitions_;
+    }
+
+    const std::vector<Result>& results() const
+    {
+      return results_;
+    }
+
+    template <class SETUP, class F>
+    const Result& run(const std::string& name, const size_t items, SETUP&& setup, F&& f)
+    {
+      for (int i = 0; i < warmup_; i++)
+      {
+        setup();
+        f();
+        clobber_memory();
+      }
+      Result result{name, items, {}};
+      for (int i = 0; i < repetitions_; i++)
+      {
+        setup();
+        clobber_memory();
+        const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+        f();
+        clobber_memory();
+        result.seconds.push_back
+          (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      }
+      std::sort(result.seconds.begin(), result.seconds.end());
+      results_.push_back(result);
+      print(results_.back());
+      return results_.back();
+    }
+
+    template <class F>
+    const Result& run(const std::string& name, const size_t items, F&& f)
+    {
+      return run(name, items, [] () {}, f);
+    }
+
+    void write_json(std::ostream& os) const
+    {
+      os << "{\n  \"suite\": \"" << escape(suite_) << "\",\n"
+         << "  \"warmup\": " << warmup_ << ",\n"
+         << "  \"repetitions\": " << repetitions_ << ",\n"
+         << "  \"benchmarks\": [";
+      for (size_t i = 0; i < results_.size(); i++)
+      {
+        const Result& r(results_[i]);
+        os << (i > 0 ? ",\n" : "\n")
+           << "    {\"name\": \"" << escape(r.name) << "\", \"items\": " << r.items
+           << ", \"min\": " << r.minimum() << ", \"median\": " << r.median()
+           << ", \"p10\": " << percentile(r.seconds, 0.1) << ", \"p90\": " << percentile(r.seconds, 0.9)
+           << ", \"ns_per_item\": " << (r.items > 0 ? 1e9*r.median()/r.items : 0) << "}";
+      }
+      os << "\n  ]\n}\n";
+    }
+
+  private:
+    static void print(const Result& r)
+    {
+      std::cout << r.name << ": " << r.median() << "s (p10 " << percentile(r.seconds, 0.1)
+                << "s, p90 " << percentile(r.seconds, 0.9) << "s, min " << r.minimum() << "s";
+      if (r.items > 0)
+        std::cout << ", " << 1e9*r.median()/r.items << "ns per item";
+      std::cout << ")\n";
+    }
+
+    static std::string escape(const std::string& s)
+    {
+      std::string r;
+      for (const char c : s)
+      {
+        if (c == '"' || c == '\\')
+          r += '\\';
+        r += c;
+      }
+      return r;
+    }
+
+    std::string suite_, json_file_;
+    int warmup_, repetitions_;
+    std::vector<Result> results_;
+  };
+}
+
+#endif
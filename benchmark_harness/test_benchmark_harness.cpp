@@ -0,0 +1,56 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include "benchmark_harness/benchmark_harness.h"
+
+/*
+ In this design test program, we check the statistics of the benchmark
+ harness and show the effect of do_not_optimize(): a loop whose result is
+ never used may be removed by the compiler entirely (e.g., with -O2), so
+ that its timing measures nothing.
+ Run it with --repetitions=N, --warmup=N or --json=FILE to change the
+ defaults.
+ */
+
+using std::cout;
+using std::endl;
+
+int main(int argc, char** argv)
+{
+  const std::vector<double> samples{1, 2, 3, 4, 5};
+  cout << "- are median and percentiles of (1,2,3,4,5) correct? "
+    << (benchmark::percentile(samples, 0.5) == 3 && std::abs(benchmark::percentile(samples, 0.1)-1.4) < 1e-12
+        && std::abs(benchmark::percentile(samples, 0.9)-4.6) < 1e-12 && benchmark::percentile(samples, 1) == 5
+        ? "yes" : "no") << endl;
+
+  benchmark::Harness harness("benchmark_harness", argc, argv);
+
+  const int N=10000000;
+  int setups=0;
+  std::vector<double> v;
+  harness.run("filling a vector", N, [&] () { v.clear(); setups++; },
+              [&] () { for (int i=0; i<N; i++) v.push_back(i); });
+  cout << "- was setup() called before every run? "
+    << (setups == harness.warmup()+harness.repetitions() && v.size() == size_t(N) ? "yes" : "no") << endl;
+
+  harness.run("summing up without a sink", N, [&] ()
+  {
+    double r=0;
+    for (int i=0; i<N; i++)
+      r += v[i];
+  });
+  harness.run("summing up with do_not_optimize()", N, [&] ()
+  {
+    double r=0;
+    for (int i=0; i<N; i++)
+      r += v[i];
+    benchmark::do_not_optimize(r);
+  });
+
+  std::ostringstream json;
+  harness.write_json(json);
+  cout << "\n" << json.str();
+
+  return 0;
+}
@@ -0,0 +1,241 @@
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <array>
+#include <span>
+#include <algorithm>
+#include <cmath>
+#include <time.h>
+
+/*
+ InfiniteVectorConstIterator hands out one (index,value) pair at a time.
+ Even trivial loops like the computation of a weighted norm can therefore not
+ be vectorized by the compiler, since the next pair has to be found by
+ chasing a pointer (std::map) or by skipping empty buckets
+ (std::unordered_map).
+
+ In this design test program, we work out a chunked traversal
+   v.for_each_block<B>(f),
+ which calls f(indices, values) with two std::spans of the same length of
+ at most B entries each, until the whole support has been visited. A user
+ kernel is then written once as a plain loop over two arrays, which the
+ compiler can vectorize:
+ 1) For contiguous backends which store indices and values in separate
+    arrays (like FlatSoAMap below), the spans point directly into the
+    storage of CONTAINER, and f is called on blocks of B entries without
+    any copy.
+ 2) All other backends (node-based ones like std::map and std::unordered_map,
+    but also flat backends with interleaved pairs) gather B entries at a time
+    into a small staging buffer on the stack, which stays in the L1 cache.
+ Note that floating-point reductions like the norms below are only vectorized
+ if the compiler may reorder the summation, e.g., with -O3 -ffast-math.
+ */
+
+using std::cout;
+using std::endl;
+
+/*
+ A flat associative container with a structure-of-arrays layout: the sorted
+ indices and the corresponding values are stored in two separate arrays.
+ */
+template <class I, class C>
+class FlatSoAMap
+{
+public:
+  typedef I key_type;
+  typedef C mapped_type;
+
+  size_t size() const
+  {
+    return _indices.size();
+  }
+
+  const std::vector<I>& indices() const
+  {
+    return _indices;
+  }
+
+  const std::vector<C>& values() const
+  {
+    return _values;
+  }
+
+  C& operator [] (const I& index)
+  {
+    typename std::vector<I>::iterator it(std::lower_bound(_indices.begin(), _indices.end(), index));
+    const size_t pos(it - _indices.begin());
+    if (it == _indices.end() || *it != index)
+    {
+      _indices.insert(it, index);
+      _values.insert(_values.begin()+pos, C());
+    }
+    return _values[pos];
+  }
+
+private:
+  std::vector<I> _indices;
+  std::vector<C> _values;
+};
+
+template <class C, class I=int, class CONTAINER=std::map<I,C> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  void set_coefficient(const I& index, const C value)
+  {
+    CONTAINER::operator [] (index) = value;
+  }
+
+  /*
+   Call f(std::span<const I> indices, std::span<const C> values) for
+   consecutive blocks of at most B entries, until all entries have been visited.
+   */
+  template <size_t B, class FUNCTION>
+  void for_each_block(FUNCTION f) const
+  {
+    static_assert(B > 0, "the block size must be positive");
+    if constexpr (requires (const CONTAINER& c) { c.indices().data(); c.values().data(); })
+    {
+      // structure of arrays: hand out views into the storage itself
+      const I* indices(CONTAINER::indices().data());
+      const C* values(CONTAINER::values().data());
+      const size_t n(CONTAINER::size());
+      for (size_t start = 0; start < n; start += B)
+      {
+        const size_t length(std::min(B, n-start));
+        f(std::span<const I>(indices+start, length), std::span<const C>(values+start, length));
+      }
+    }
+    else
+    {
+      // gather blocks into a staging buffer
+      std::array<I,B> indices;
+      std::array<C,B> values;
+      size_t length(0);
+      for (typename CONTAINER::const_iterator it(CONTAINER::begin()); it != CONTAINER::end(); ++it)
+      {
+        indices[length] = it->first;
+        values[length] = it->second;
+        if (++length == B)
+        {
+          f(std::span<const I>(indices.data(), B), std::span<const C>(values.data(), B));
+          length = 0;
+        }
+      }
+      if (length > 0)
+        f(std::span<const I>(indices.data(), length), std::span<const C>(values.data(), length));
+    }
+  }
+
+  // the classical traversal, one entry at a time
+  template <class FUNCTION>
+  void for_each(FUNCTION f) const
+  {
+    if constexpr (requires (const CONTAINER& c) { c.indices().data(); c.values().data(); })
+    {
+      for (size_t k = 0; k < CONTAINER::size(); k++)
+        f(CONTAINER::indices()[k], CONTAINER::values()[k]);
+    }
+    else
+    {
+      for (typename CONTAINER::const_iterator it(CONTAINER::begin()); it != CONTAINER::end(); ++it)
+        f(it->first, it->second);
+    }
+  }
+};
+
+// a weighted l2 norm with weights 1/(1+i/N), written as a block kernel
+template <class VECTOR>
+double weighted_norm_blocks(const VECTOR& v, const double N)
+{
+  double r(0);
+  v.template for_each_block<64>([&r, N] (std::span<const int> indices, std::span<const double> values)
+  {
+    double s(0);
+    for (size_t k = 0; k < indices.size(); k++)
+      s += values[k] * values[k] / (1.0 + indices[k]/N);
+    r += s;
+  });
+  return sqrt(r);
+}
+
+// the same norm, one entry at a time
+template <class VECTOR>
+double weighted_norm(const VECTOR& v, const double N)
+{
+  double r(0);
+  v.for_each([&r, N] (const int index, const double value)
+  {
+    r += value * value / (1.0 + index/N);
+  });
+  return sqrt(r);
+}
+
+// the l_infinity norm as a block kernel
+template <class VECTOR>
+double linf_norm_blocks(const VECTOR& v)
+{
+  double r(0);
+  v.template for_each_block<64>([&r] (std::span<const int>, std::span<const double> values)
+  {
+    for (size_t k = 0; k < values.size(); k++)
+      r = std::max(r, fabs(values[k]));
+  });
+  return r;
+}
+
+template <class VECTOR>
+void benchmark(const char* name, const VECTOR& v, const int N, const int repetitions)
+{
+  double r1=0, r2=0;
+  clock_t start=clock();
+  for (int r=0; r<repetitions; r++)
+    r1 += weighted_norm(v, N);
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    r2 += weighted_norm_blocks(v, N);
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << name << ": entry by entry " << dur1 << "s, blockwise " << dur2 << "s"
+    << " (relative deviation " << fabs(r1-r2)/r1 << ", max. entry " << linf_norm_blocks(v) << ")\n";
+}
+
+int main()
+{
+  const int N=200000;
+  InfiniteVector<double,int> v;
+  InfiniteVector<double,int,std::unordered_map<int,double> > u;
+  InfiniteVector<double,int,FlatSoAMap<int,double> > f;
+  for (int i=0; i<N; i++)
+    if (i%3 != 1)
+    {
+      const double value=1.0+(i%11)-5.0;
+      v.set_coefficient(i, value);
+      u.set_coefficient(i, value);
+      f.set_coefficient(i, value);
+    }
+
+  // count the blocks handed out to the kernel
+  size_t blocks=0, entries=0;
+  v.for_each_block<64>([&] (std::span<const int> indices, std::span<const double>)
+  {
+    blocks++;
+    entries += indices.size();
+  });
+  cout << "- for_each_block<64> visits " << entries << " of " << v.size()
+    << " entries in " << blocks << " blocks" << endl << endl;
+
+  const int repetitions=20;
+  benchmark("std::map", v, N, repetitions);
+  benchmark("std::unordered_map", u, N, repetitions);
+  benchmark("FlatSoAMap", f, N, repetitions);
+
+  return 0;
+}
@@ -0,0 +1,298 @@
+#include <iostream>
+#include <map>
+#include <vector>
+#include <array>
+#include <span>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <cassert>
+
+/*
+ Assembly routines (e.g., the application of an adaptive operator) produce
+ their results as a long stream of unsorted contributions (index, value),
+ where the same index may occur many times. So far, the only way to turn
+ such a stream into an InfiniteVector is to add up the contributions one by
+ one, i.e., to perform one tree search (and, for new indices, one insertion
+ with rebalancing) per contribution.
+
+ In this design test program, we work out a bulk constructor
+   InfiniteVector(indices, values, nthreads)
+ for unsorted coordinate (COO) streams:
+ 1) Every index is mapped to an unsigned 64-bit code by IndexCode<I>. The codes
+    have to be ordered like the indices in CONTAINER, e.g., for the keys
+    (j,k) in a std::map with Key_Compare2, the code is Cantor's nr(j,k).
+ 2) The (code,index,value) triples are sorted with a least significant digit
+    radix sort on the codes, in bytes, skipping all leading bytes which are
+    zero for all codes. Each pass computes one histogram per thread on a
+    contiguous chunk, and then every thread scatters its chunk to the offsets
+    given by the prefix sums. Since the sort is stable, duplicate indices
+    are summed up in the order of the input stream.
+ 3) Duplicates are summed up in a single pass, and the results are appended
+    to CONTAINER with emplace_hint() at its end, which is amortized O(1)
+    for std::map, since the entries arrive in order.
+ */
+
+using std::cout;
+using std::endl;
+
+// a tuple (j,k) of nonnegative integers, ordered by Cantor's enumeration nr()
+class Key
+{
+public:
+  int j, k;
+
+  Key()
+  : j(0), k(0)
+  {
+  }
+
+  Key(int x, int y)
+  : j(x), k(y)
+  {
+  }
+
+  long int nr() const
+  {
+    return (long(j)+k)*(long(j)+k+1)/2+j;
+  }
+
+  bool operator == (const Key& vgl) const
+  {
+    return (j == vgl.j && k == vgl.k);
+  }
+};
+
+// sorting Keys with nr()
+struct Key_Compare2
+{
+  bool operator() (const Key& lhs, const Key& rhs) const
+  {
+    return (lhs.nr() < rhs.nr());
+  }
+};
+
+// order preserving unsigned codes of the indices
+template <class I> struct IndexCode;
+
+template <>
+struct IndexCode<int>
+{
+  static uint64_t code(const int index)
+  {
+    // flip the sign bit of the 32-bit pattern, so that negative indices come
+    // first and the code has at most 4 nonzero bytes (i.e., radix passes)
+    return uint32_t(index) ^ 0x80000000u;
+  }
+};
+
+template <>
+struct IndexCode<Key>
+{
+  static uint64_t code(const Key& index)
+  {
+    return index.nr();
+  }
+};
+
+// one contribution of a COO stream, together with the code of its index
+template <class C, class I>
+struct CooEntry
+{
+  uint64_t code;
+  I index;
+  C value;
+};
+
+// run f(t,begin,end) on nthreads contiguous chunks of [0,n) concurrently
+template <class FUNCTION>
+void for_each_chunk(const size_t n, const unsigned int nthreads, FUNCTION f)
+{
+  assert(nthreads >= 1);
+  if (nthreads == 1)
+  {
+    f(0, 0, n);
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (unsigned int t = 0; t < nthreads; t++)
+    threads.emplace_back(f, t, n*t/nthreads, n*(t+1)/nthreads);
+  for (unsigned int t = 0; t < nthreads; t++)
+    threads[t].join();
+}
+
+// stable LSD radix sort of the entries by their codes, one byte per pass
+template <class ENTRY>
+void radix_sort(std::vector<ENTRY>& entries, const unsigned int nthreads)
+{
+  const size_t n(entries.size());
+  uint64_t maxcode(0);
+  for (size_t i = 0; i < n; i++)
+    maxcode = std::max(maxcode, entries[i].code);
+
+  std::vector<ENTRY> buffer(n);
+  std::vector<std::array<size_t,256> > offsets(nthreads);
+  for (unsigned int shift = 0; shift < 64 && (maxcode >> shift) != 0; shift += 8)
+  {
+    // one histogram per chunk
+    for_each_chunk(n, nthreads, [&] (const unsigned int t, const size_t begin, const size_t end)
+    {
+      offsets[t].fill(0);
+      for (size_t i = begin; i < end; i++)
+        offsets[t][(entries[i].code >> shift) & 0xFF]++;
+    });
+
+    // prefix sums, digit by digit and chunk by chunk
+    size_t offset(0);
+    for (unsigned int d = 0; d < 256; d++)
+      for (unsigned int t = 0; t < nthreads; t++)
+      {
+        const size_t count(offsets[t][d]);
+        offsets[t][d] = offset;
+        offset += count;
+      }
+
+    // scatter
+    for_each_chunk(n, nthreads, [&] (const unsigned int t, const size_t begin, const size_t end)
+    {
+      std::array<size_t,256>& position(offsets[t]);
+      for (size_t i = begin; i < end; i++)
+        buffer[position[(entries[i].code >> shift) & 0xFF]++] = entries[i];
+    });
+
+    entries.swap(buffer);
+  }
+}
+
+template <class C, class I=int, class CONTAINER=std::map<I,C> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  typedef typename CONTAINER::const_iterator const_iterator;
+  typedef typename CONTAINER::value_type value_type;
+
+  InfiniteVector()
+  : CONTAINER()
+  {
+  }
+
+  /*
+   Construct a vector from an unsorted stream of contributions
+   (indices[i],values[i]), adding up all contributions to the same index;
+   entries which sum up to zero are not stored. At least one thread is used.
+   */
+  InfiniteVector(std::span<const I> indices, std::span<const C> values,
+                 const unsigned int nthreads = 1)
+  : CONTAINER()
+  {
+    assert(indices.size() == values.size());
+    const size_t n(indices.size());
+    const unsigned int threads(std::max(1u, nthreads));
+    std::vector<CooEntry<C,I> > entries(n);
+    for_each_chunk(n, threads, [&] (const unsigned int, const size_t begin, const size_t end)
+    {
+      for (size_t i = begin; i < end; i++)
+      {
+        entries[i].code = IndexCode<I>::code(indices[i]);
+        entries[i].index = indices[i];
+        entries[i].value = values[i];
+      }
+    });
+
+    radix_sort(entries, threads);
+
+    for (size_t i = 0; i < n;)
+    {
+      C sum(entries[i].value);
+      size_t l(i+1);
+      for (; l < n && entries[l].code == entries[i].code; l++)
+        sum += entries[l].value;
+      if (sum != C(0))
+        CONTAINER::emplace_hint(CONTAINER::end(), entries[i].index, sum);
+      i = l;
+    }
+  }
+
+  const_iterator begin() const
+  {
+    return CONTAINER::begin();
+  }
+
+  const_iterator end() const
+  {
+    return CONTAINER::end();
+  }
+
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  void add_coefficient(const I& index, const C increment)
+  {
+    CONTAINER::operator [] (index) += increment;
+  }
+
+  bool operator == (const InfiniteVector<C,I,CONTAINER>& v) const
+  {
+    return (size()==v.size()) && std::equal(begin(), end(), v.begin());
+  }
+};
+
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <class I, class CONTAINER>
+void benchmark(const char* name, const std::vector<I>& indices, const std::vector<double>& values)
+{
+  typedef InfiniteVector<double,I,CONTAINER> Vector;
+
+  std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+  Vector v;
+  for (size_t i=0; i<indices.size(); i++)
+    v.add_coefficient(indices[i], values[i]);
+  const double dur1=seconds_since(start);
+
+  start=std::chrono::steady_clock::now();
+  Vector w(indices, values);
+  const double dur2=seconds_since(start);
+
+  const unsigned int nthreads=std::max(2u, std::thread::hardware_concurrency());
+  start=std::chrono::steady_clock::now();
+  Vector z(indices, values, nthreads);
+  const double dur3=seconds_since(start);
+
+  cout << "- " << name << ": " << indices.size() << " contributions to "
+    << w.size() << " indices, results agree? " << (v==w && v==z ? "yes" : "no") << endl
+    << "  one insertion per contribution: " << dur1 << "s" << endl
+    << "  bulk construction, 1 thread: " << dur2 << "s" << endl
+    << "  bulk construction, " << nthreads << " threads: " << dur3 << "s" << endl;
+}
+
+int main()
+{
+  // raise N to 10^7 for production-sized streams
+  const size_t N=1000000;
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> translation(0, 999);
+
+  std::vector<Key> keys(N);
+  std::vector<int> ints(N);
+  std::vector<double> values(N);
+  for (size_t i=0; i<N; i++)
+  {
+    keys[i]=Key(translation(generator), translation(generator));
+    ints[i]=translation(generator)*1000-500000+translation(generator);
+    values[i]=0.25*(1+translation(generator)%8);
+  }
+
+  benchmark<Key,std::map<Key,double,Key_Compare2> >("keys (j,k), std::map with Key_Compare2", keys, values);
+  benchmark<int,std::map<int,double> >("int indices, std::map", ints, values);
+
+  return 0;
+}
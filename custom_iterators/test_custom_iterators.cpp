@@ -1,6 +1,9 @@
 #include <iostream>
 #include <vector>
 #include <iterator>
+#include <algorithm>
+#include <ranges>
+#include <time.h>
 
 /*
  The goal of this design test program is to implement a class with
@@ -10,6 +13,13 @@
  in (an old version of) InfiniteVector::operator == () when compiling with
  CLang under macOS.
  
+ Since C++20, the end of a range may be marked by a sentinel of a different
+ type than the iterator. PrimeContainer::end() returns std::default_sentinel,
+ and the comparison it==end() boils down to the test _k>N. Moreover, the sieve
+ has an extra entry for N+1, which is marked as a prime, so that operator ++
+ can search for the next marked entry without checking for the last prime.
+ Compile with -O2 -S and inspect count_primes() to see the tight loop.
+ 
  Thorsten Raasch, November 2018
  */
 
@@ -25,9 +35,10 @@ class PrimeContainer
 public:
   friend class PrimeIterator<N>;
   typedef PrimeIterator<N> iterator;
+  typedef std::default_sentinel_t sentinel;
 
   PrimeContainer ()
-  : _sieve(N)
+  : _sieve(N+1)
   {
     // run Eratosthenes' sieve algorithm
     _sieve[0] = false; // 1 is not prime
@@ -44,8 +55,8 @@ public:
         for (k++; !_sieve[k-1] && k*k<N; k++);
       }
     
-    // store maximal prime
-    for (_maxprime=N; _maxprime>2 && !_sieve[_maxprime-1]; _maxprime--);
+    // mark N+1 as a stopper for the search of the next prime
+    _sieve[N] = true;
     
     // store number of primes
     _nprimes=0;
@@ -65,9 +76,9 @@ public:
     return iterator(*this, 2);
   }
   
-  iterator end() const
+  sentinel end() const
   {
-    return iterator(*this, N+1);
+    return std::default_sentinel;
   }
   
   size_t size() const
@@ -76,8 +87,7 @@ public:
   }
   
 private:
-  std::vector<bool> _sieve; // sieve for natural numbers 1,...,N
-  int _maxprime;
+  std::vector<bool> _sieve; // sieve for natural numbers 1,...,N+1
   size_t _nprimes;
 };
 
@@ -109,14 +119,19 @@ public:
   typedef std::forward_iterator_tag iterator_category;
   typedef int difference_type;
   typedef int value_type;
-  typedef value_type& reference;
-  typedef value_type* pointer;
+  typedef const value_type& reference;
+  typedef const value_type* pointer;
 private:
-  const PrimeContainer<N>& _container; // parent container
+  const PrimeContainer<N>* _container; // parent container
   int _k; // current state (= current prime)
 public:
+  PrimeIterator()
+  : _container(nullptr), _k(N+1)
+  {
+  }
+  
   PrimeIterator(const PrimeContainer<N>& container, const int k)
-  : _container(container), _k(k)
+  : _container(&container), _k(k)
   {
   }
   
@@ -125,40 +140,53 @@ public:
     return (_k== it._k);
   }
 
-  bool operator != (const PrimeIterator<N>& it) const
+  // comparison with end(); != and the reversed versions are generated by C++20
+  bool operator == (std::default_sentinel_t) const
   {
-    return !(*this == it);
+    return _k > N;
   }
   
   PrimeIterator<N>& operator ++ ()
   {
-    if (_k==_container._maxprime)
-    {
-      // jump to end()
-      _k=N+1;
-    }
-    else // _k<_container._maxprime
-    {
-      // jump to next prime (there is at least one)
-      _k++;
-      for (; !(_container._sieve[_k-1]); _k++);
-    }
+    // jump to next prime or to the stopper N+1
+    for (_k++; !(_container->_sieve[_k-1]); _k++);
     return *this;
   }
   
-  reference operator * ()
+  PrimeIterator<N> operator ++ (int)
+  {
+    PrimeIterator<N> r(*this);
+    ++(*this);
+    return r;
+  }
+  
+  reference operator * () const
   {
     return _k;
   }
   
-  pointer operator -> ()
+  pointer operator -> () const
   {
     return &_k;
   }
 };
 
+// the number of primes up to N, adding them up to sum, as a plain loop against the sentinel
+template <int N>
+long count_primes(const PrimeContainer<N>& p, long& sum)
+{
+  long n(0);
+  for (typename PrimeContainer<N>::iterator it(p.begin()); it != p.end(); ++it, n++)
+    sum += *it;
+  return n;
+}
+
 int main()
 {
+  static_assert(std::forward_iterator<PrimeIterator<23> >);
+  static_assert(std::sentinel_for<std::default_sentinel_t, PrimeIterator<23> >);
+  static_assert(std::ranges::forward_range<PrimeContainer<23> >);
+
   const int M=23;
   PrimeContainer<M> p;
   cout << "- the primes from 2 to " << M << ":" << endl;
@@ -171,10 +199,35 @@ int main()
   cout << q << endl;
   cout << "- these are " << q.size() << " prime numbers" << endl;
 
-  // use std::equal to test whether these sets of prime numbers are equal
+  // use std::ranges::equal to test whether these sets of prime numbers are equal
+  // (std::equal needs iterators of the same type for both ends)
   cout << "- these two sets of primes are ";
-  if ((p.size()==q.size()) && std::equal(p.begin(), p.end(), q.begin()))
+  if ((p.size()==q.size()) && std::ranges::equal(p, q))
     cout << "equal!" << endl;
   else
     cout << "different!" << endl;
+
+  // traverse a large sieve, once via the iterators and once via is_prime()
+  const int L=10000000;
+  const PrimeContainer<L> large;
+  const int repetitions=2;
+  long n1=0, n2=0, sum1=0, sum2=0;
+  clock_t start=clock();
+  for (int r=0; r<repetitions; r++)
+    n1 += count_primes(large, sum1);
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    for (int k=2; k<=L; k++)
+      if (large.is_prime(k))
+      {
+        n2++;
+        sum2 += k;
+      }
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << "- there are " << large.size() << " primes up to " << L
+    << ", both traversals agree? " << (n1==n2 && sum1==sum2 ? "yes" : "no") << endl;
+
+  cout << "\nPrimeIterator against the sentinel: " << dur1 << "s\n";
+  cout << "loop over is_prime(): " << dur2 << "s\n";
 }
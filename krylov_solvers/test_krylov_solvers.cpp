@@ -0,0 +1,610 @@
+#include <iostream>
+#include <map>
+#include <vector>
+#include <memory_resource>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <time.h>
+
+/*
+ Iterative solvers like CG, MINRES and GMRES spend a surprising amount of
+ their runtime in the construction and destruction of temporary
+ InfiniteVector objects, if they are written down literally, e.g.,
+ r = r - alpha*A*p creates (and destroys) three std::map objects and
+ allocates one tree node per nonzero entry of each of them.
+
+ In this design test program, we work out Krylov solvers on InfiniteVector
+ that do not create temporaries at all:
+ 1) All auxiliary vectors live in a KrylovWorkspace which is set up once and
+    can be reused for several solves. The solvers only use in-place BLAS level 1
+    operations (add(), sadd(), scale(), swap(), the copy assignment) on these
+    vectors. Note that the copy assignment of std::map reuses the tree nodes
+    of the target.
+ 2) When the support of the iterates grows, new tree nodes are needed.
+    If CONTAINER is a std::pmr::map and the workspace vectors share a
+    std::pmr::unsynchronized_pool_resource, nodes released by one vector
+    (e.g., by clear()) are recycled by the others, so that after the first
+    few iterations (or after the first solve), no more memory has to be
+    requested from the system.
+ 3) The solvers are templates in the operator type, which only has to provide
+    a method apply(InfiniteVector& y, const InfiniteVector& x) computing y=Ax.
+ */
+
+using std::cout;
+using std::endl;
+
+template <class C, class I=int, class CONTAINER=std::map<I,C> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  typedef typename CONTAINER::const_iterator const_iterator;
+  typedef typename CONTAINER::value_type value_type;
+  typedef typename CONTAINER::allocator_type allocator_type;
+
+  InfiniteVector()
+  : CONTAINER()
+  {
+  }
+
+  explicit InfiniteVector(const allocator_type& allocator)
+  : CONTAINER(allocator)
+  {
+  }
+
+  InfiniteVector(const InfiniteVector<C,I,CONTAINER>& v) = default;
+
+  // assignment reuses the nodes of *this
+  InfiniteVector<C,I,CONTAINER>& operator = (const InfiniteVector<C,I,CONTAINER>& v) = default;
+
+  const_iterator begin() const
+  {
+    return CONTAINER::begin();
+  }
+
+  const_iterator end() const
+  {
+    return CONTAINER::end();
+  }
+
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  void clear()
+  {
+    CONTAINER::clear();
+  }
+
+  void swap(InfiniteVector<C,I,CONTAINER>& v)
+  {
+    CONTAINER::swap(v);
+  }
+
+  C get_coefficient(const I& index) const
+  {
+    const_iterator it(CONTAINER::find(index));
+    return (it == CONTAINER::end() ? C(0) : it->second);
+  }
+
+  void set_coefficient(const I& index, const C value)
+  {
+    CONTAINER::operator [] (index) = value;
+  }
+
+  void add_coefficient(const I& index, const C increment)
+  {
+    CONTAINER::operator [] (index) += increment;
+  }
+
+  // *this *= alpha
+  void scale(const C alpha)
+  {
+    for (typename CONTAINER::iterator it(CONTAINER::begin()); it != CONTAINER::end(); ++it)
+      it->second *= alpha;
+  }
+
+  // *this += alpha*v, merging the two sorted supports
+  void add(const C alpha, const InfiniteVector<C,I,CONTAINER>& v)
+  {
+    typename CONTAINER::iterator hint(CONTAINER::begin());
+    for (const_iterator it(v.begin()); it != v.end(); ++it)
+    {
+      while (hint != CONTAINER::end() && hint->first < it->first)
+        ++hint;
+      if (hint != CONTAINER::end() && hint->first == it->first)
+        hint->second += alpha * it->second;
+      else
+        CONTAINER::emplace_hint(hint, it->first, alpha * it->second);
+    }
+  }
+
+  // *this = alpha*(*this) + v
+  void sadd(const C alpha, const InfiniteVector<C,I,CONTAINER>& v)
+  {
+    scale(alpha);
+    add(C(1), v);
+  }
+
+  // inner product, walking through both sorted supports simultaneously
+  C operator * (const InfiniteVector<C,I,CONTAINER>& v) const
+  {
+    C r(0);
+    const_iterator it(begin()), vit(v.begin());
+    while (it != end() && vit != v.end())
+    {
+      if (it->first < vit->first)
+        ++it;
+      else if (vit->first < it->first)
+        ++vit;
+      else
+        r += (it++)->second * (vit++)->second;
+    }
+    return r;
+  }
+
+  double l2_norm() const
+  {
+    double r(0);
+    for (const_iterator it(begin()); it != end(); ++it)
+      r += it->second * it->second;
+    return sqrt(r);
+  }
+};
+
+// arithmetic with temporaries, as used in the literal textbook implementation
+template <class C, class I, class CONTAINER>
+InfiniteVector<C,I,CONTAINER> operator + (const InfiniteVector<C,I,CONTAINER>& v,
+                                          const InfiniteVector<C,I,CONTAINER>& w)
+{
+  InfiniteVector<C,I,CONTAINER> r(v);
+  r.add(C(1), w);
+  return r;
+}
+
+template <class C, class I, class CONTAINER>
+InfiniteVector<C,I,CONTAINER> operator * (const C alpha, const InfiniteVector<C,I,CONTAINER>& v)
+{
+  InfiniteVector<C,I,CONTAINER> r(v);
+  r.scale(alpha);
+  return r;
+}
+
+/*
+ The workspace of the Krylov solvers: a fixed set of auxiliary vectors
+ (all of them using the same allocator) and some scalar storage for the
+ Hessenberg matrix and the Givens rotations of GMRES.
+ */
+template <class VECTOR>
+class KrylovWorkspace
+{
+public:
+  typedef typename VECTOR::allocator_type allocator_type;
+
+  // restart is the maximal dimension of the Krylov subspaces in GMRES(restart)
+  explicit KrylovWorkspace(const unsigned int restart = 20,
+                           const allocator_type& allocator = allocator_type())
+  : _restart(restart),
+    _H((restart+1)*restart), _cs(restart), _sn(restart), _g(restart+1)
+  {
+    assert(restart > 0); // GMRES(0) would never make progress
+    const size_t nvectors(std::max<size_t>(7, restart+3));
+    _vectors.reserve(nvectors);
+    for (size_t k = 0; k < nvectors; k++)
+      _vectors.emplace_back(allocator);
+  }
+
+  unsigned int restart() const
+  {
+    return _restart;
+  }
+
+  VECTOR& operator [] (const size_t k)
+  {
+    return _vectors[k];
+  }
+
+  // entry (i,j) of the (restart+1)x(restart) Hessenberg matrix
+  double& H(const unsigned int i, const unsigned int j)
+  {
+    return _H[j*(_restart+1)+i];
+  }
+
+  std::vector<double>& cs() { return _cs; }
+  std::vector<double>& sn() { return _sn; }
+  std::vector<double>& g() { return _g; }
+
+private:
+  unsigned int _restart;
+  std::vector<VECTOR> _vectors;
+  std::vector<double> _H, _cs, _sn, _g;
+};
+
+/*
+ Conjugate gradients for symmetric positive definite A.
+ Stops as soon as ||b-Ax|| <= tol*||b|| or after maxit iterations;
+ returns true on convergence, the number of iterations is stored in iterations.
+ */
+template <class OPERATOR, class VECTOR>
+bool CG(const OPERATOR& A, const VECTOR& b, VECTOR& x, KrylovWorkspace<VECTOR>& ws,
+        const double tol, const unsigned int maxit, unsigned int& iterations)
+{
+  VECTOR& r(ws[0]);
+  VECTOR& p(ws[1]);
+  VECTOR& Ap(ws[2]);
+
+  const double bound(tol*b.l2_norm());
+
+  // r = p = b-Ax
+  A.apply(Ap, x);
+  r = b;
+  r.add(-1.0, Ap);
+  p = r;
+  double rr(r*r);
+
+  for (iterations = 0; iterations < maxit; iterations++)
+  {
+    if (sqrt(rr) <= bound)
+      return true;
+    A.apply(Ap, p);
+    const double alpha(rr/(p*Ap));
+    x.add(alpha, p);
+    r.add(-alpha, Ap);
+    const double rrnew(r*r);
+    p.sadd(rrnew/rr, r);
+    rr = rrnew;
+  }
+
+  return (sqrt(rr) <= bound);
+}
+
+/*
+ MINRES for symmetric (possibly indefinite) A, see Paige/Saunders (1975).
+ The Lanczos vectors and search directions are rotated by swap(), which is
+ O(1) for std::map.
+ */
+template <class OPERATOR, class VECTOR>
+bool MINRES(const OPERATOR& A, const VECTOR& b, VECTOR& x, KrylovWorkspace<VECTOR>& ws,
+            const double tol, const unsigned int maxit, unsigned int& iterations)
+{
+  VECTOR& v_old(ws[0]);
+  VECTOR& v(ws[1]);
+  VECTOR& v_new(ws[2]);
+  VECTOR& w_old(ws[3]);
+  VECTOR& w(ws[4]);
+  VECTOR& w_new(ws[5]);
+
+  const double bound(tol*b.l2_norm());
+
+  // v = r/||r||, r = b-Ax
+  A.apply(v_new, x);
+  v = b;
+  v.add(-1.0, v_new);
+  double beta(v.l2_norm());
+  double eta(beta);
+  v_old.clear();
+  w_old.clear();
+  w.clear();
+  if (beta > 0)
+    v.scale(1.0/beta);
+
+  double c(1), c_old(1), s(0), s_old(0);
+
+  for (iterations = 0; iterations < maxit; iterations++)
+  {
+    if (fabs(eta) <= bound)
+      return true;
+
+    // Lanczos step
+    A.apply(v_new, v);
+    const double alpha(v*v_new);
+    v_new.add(-alpha, v);
+    v_new.add(-beta, v_old);
+    const double beta_new(v_new.l2_norm());
+
+    // QR update
+    const double delta(c*alpha - c_old*s*beta);
+    const double rho1(sqrt(delta*delta + beta_new*beta_new));
+    const double rho2(s*alpha + c_old*c*beta);
+    const double rho3(s_old*beta);
+    const double c_new(delta/rho1), s_new(beta_new/rho1);
+
+    // w_new = (v - rho3*w_old - rho2*w)/rho1
+    w_new = v;
+    w_new.add(-rho3, w_old);
+    w_new.add(-rho2, w);
+    w_new.scale(1.0/rho1);
+
+    x.add(c_new*eta, w_new);
+    eta = -s_new*eta;
+
+    // shift the recurrences
+    v_old.swap(v);
+    v.swap(v_new);
+    if (beta_new > 0)
+      v.scale(1.0/beta_new);
+    w_old.swap(w);
+    w.swap(w_new);
+    c_old = c; c = c_new;
+    s_old = s; s = s_new;
+    beta = beta_new;
+  }
+
+  return (fabs(eta) <= bound);
+}
+
+/*
+ Restarted GMRES(m) for general A, m being the restart parameter of the
+ workspace. The Arnoldi basis is orthogonalized with modified Gram-Schmidt,
+ the least squares problems are solved with Givens rotations.
+ */
+template <class OPERATOR, class VECTOR>
+bool GMRES(const OPERATOR& A, const VECTOR& b, VECTOR& x, KrylovWorkspace<VECTOR>& ws,
+           const double tol, const unsigned int maxit, unsigned int& iterations)
+{
+  const unsigned int m(ws.restart());
+  VECTOR& r(ws[0]);
+  VECTOR& w(ws[1]);
+  std::vector<double>& cs(ws.cs());
+  std::vector<double>& sn(ws.sn());
+  std::vector<double>& g(ws.g());
+
+  // basis vector V[i] is ws[2+i], i=0,...,m
+  const double bound(tol*b.l2_norm());
+  double residual(0);
+
+  iterations = 0;
+  while (true)
+  {
+    // r = b-Ax
+    A.apply(w, x);
+    r = b;
+    r.add(-1.0, w);
+    residual = r.l2_norm();
+    if (residual <= bound || iterations >= maxit)
+      break;
+
+    ws[2].swap(r);
+    ws[2].scale(1.0/residual);
+    std::fill(g.begin(), g.end(), 0.0);
+    g[0] = residual;
+
+    unsigned int k(0);
+    for (unsigned int j = 0; j < m && iterations < maxit; j++)
+    {
+      iterations++;
+      k = j+1;
+
+      // Arnoldi step
+      A.apply(w, ws[2+j]);
+      for (unsigned int i = 0; i <= j; i++)
+      {
+        ws.H(i,j) = w*ws[2+i];
+        w.add(-ws.H(i,j), ws[2+i]);
+      }
+      ws.H(j+1,j) = w.l2_norm();
+      ws[3+j].swap(w);
+      if (ws.H(j+1,j) > 0)
+        ws[3+j].scale(1.0/ws.H(j+1,j));
+
+      // apply the previous rotations to the new column, then compute a new one
+      for (unsigned int i = 0; i < j; i++)
+      {
+        const double temp(cs[i]*ws.H(i,j) + sn[i]*ws.H(i+1,j));
+        ws.H(i+1,j) = -sn[i]*ws.H(i,j) + cs[i]*ws.H(i+1,j);
+        ws.H(i,j) = temp;
+      }
+      const double denom(hypot(ws.H(j,j), ws.H(j+1,j)));
+      cs[j] = ws.H(j,j)/denom;
+      sn[j] = ws.H(j+1,j)/denom;
+      ws.H(j,j) = denom;
+      ws.H(j+1,j) = 0;
+      g[j+1] = -sn[j]*g[j];
+      g[j] = cs[j]*g[j];
+
+      if (fabs(g[j+1]) <= bound)
+        break;
+    }
+
+    // solve the triangular system H(0:k,0:k)y=g in place and update x
+    for (int i = k-1; i >= 0; i--)
+    {
+      for (unsigned int l = i+1; l < k; l++)
+        g[i] -= ws.H(i,l)*g[l];
+      g[i] /= ws.H(i,i);
+      x.add(g[i], ws[2+i]);
+    }
+  }
+
+  return (residual <= bound);
+}
+
+/*
+ A tridiagonal test operator on the indices 0,...,n-1, i.e.,
+   (Ax)_i = lower*x_{i-1} + diag*x_i + upper*x_{i+1}.
+ If alternating is true, the sign of the diagonal entries alternates,
+ which gives a well-conditioned symmetric indefinite operator.
+ The support of Ax is the support of x, enlarged by one index in both directions.
+ */
+template <class VECTOR>
+class TridiagonalOperator
+{
+public:
+  TridiagonalOperator(const int n, const double lower, const double diag, const double upper,
+                      const bool alternating = false)
+  : _n(n), _lower(lower), _diag(diag), _upper(upper), _alternating(alternating)
+  {
+  }
+
+  void apply(VECTOR& y, const VECTOR& x) const
+  {
+    y.clear();
+    for (typename VECTOR::const_iterator it(x.begin()); it != x.end(); ++it)
+    {
+      const int i(it->first);
+      if (i > 0)
+        y.add_coefficient(i-1, _upper*it->second);
+      y.add_coefficient(i, (_alternating && i%2 ? -_diag : _diag)*it->second);
+      if (i+1 < _n)
+        y.add_coefficient(i+1, _lower*it->second);
+    }
+  }
+
+private:
+  int _n;
+  double _lower, _diag, _upper;
+  bool _alternating;
+};
+
+// CG as written down in the textbook, creating temporaries in every iteration
+template <class OPERATOR, class VECTOR>
+bool CG_with_temporaries(const OPERATOR& A, const VECTOR& b, VECTOR& x,
+                         const double tol, const unsigned int maxit, unsigned int& iterations)
+{
+  const double bound(tol*b.l2_norm());
+  VECTOR Ax;
+  A.apply(Ax, x);
+  VECTOR r(b + (-1.0)*Ax), p(r);
+  double rr(r*r);
+  for (iterations = 0; iterations < maxit && sqrt(rr) > bound; iterations++)
+  {
+    VECTOR Ap;
+    A.apply(Ap, p);
+    const double alpha(rr/(p*Ap));
+    x = x + alpha*p;
+    r = r + (-alpha)*Ap;
+    const double rrnew(r*r);
+    p = r + (rrnew/rr)*p;
+    rr = rrnew;
+  }
+  return (sqrt(rr) <= bound);
+}
+
+// an upstream memory resource that counts the number of allocations
+class CountingResource
+  : public std::pmr::memory_resource
+{
+public:
+  size_t allocations = 0;
+
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override
+  {
+    allocations++;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override
+  {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+};
+
+template <class VECTOR>
+double residual_norm(const TridiagonalOperator<VECTOR>& A, const VECTOR& b, const VECTOR& x)
+{
+  VECTOR r;
+  A.apply(r, x);
+  r.add(-1.0, b);
+  return r.l2_norm()/b.l2_norm();
+}
+
+int main()
+{
+  typedef InfiniteVector<double,int> Vector;
+  typedef InfiniteVector<double,int,std::pmr::map<int,double> > PoolVector;
+
+  const int n=2000;
+  const double tol=1e-10;
+  const unsigned int maxit=5000;
+  unsigned int iterations;
+
+  // a few point sources, so that the support of the iterates grows
+  Vector b;
+  b.set_coefficient(n/4, 1.0);
+  b.set_coefficient(n/2, -2.0);
+  b.set_coefficient(3*n/4, 1.0);
+
+  CountingResource counter;
+  std::pmr::unsynchronized_pool_resource pool(&counter);
+  PoolVector bpool{PoolVector::allocator_type(&pool)};
+  for (Vector::const_iterator it(b.begin()); it != b.end(); ++it)
+    bpool.set_coefficient(it->first, it->second);
+
+  // CG on a symmetric positive definite operator
+  {
+    TridiagonalOperator<Vector> A(n, -1.0, 2.1, -1.0);
+    Vector x;
+    clock_t start(clock());
+    CG_with_temporaries(A, b, x, tol, maxit, iterations);
+    const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+    cout << "- CG with temporaries: " << iterations << " iterations, relative residual "
+      << residual_norm(A, b, x) << ", " << dur1 << "s" << endl;
+
+    KrylovWorkspace<Vector> ws;
+    x.clear();
+    start=clock();
+    CG(A, b, x, ws, tol, maxit, iterations);
+    const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+    cout << "- CG with workspace: " << iterations << " iterations, relative residual "
+      << residual_norm(A, b, x) << ", " << dur2 << "s" << endl;
+
+    TridiagonalOperator<PoolVector> Apool(n, -1.0, 2.1, -1.0);
+    KrylovWorkspace<PoolVector> wspool(20, PoolVector::allocator_type(&pool));
+    PoolVector xpool{PoolVector::allocator_type(&pool)};
+    start=clock();
+    CG(Apool, bpool, xpool, wspool, tol, maxit, iterations);
+    const double dur3=(clock() - start) / (double) CLOCKS_PER_SEC;
+    const size_t allocations=counter.allocations;
+    cout << "- CG with workspace and node pool: " << iterations << " iterations, relative residual "
+      << residual_norm(Apool, bpool, xpool) << ", " << dur3 << "s, "
+      << allocations << " upstream allocations" << endl;
+
+    xpool.clear();
+    start=clock();
+    CG(Apool, bpool, xpool, wspool, tol, maxit, iterations);
+    const double dur4=(clock() - start) / (double) CLOCKS_PER_SEC;
+    cout << "- CG with workspace and node pool, second solve: " << iterations
+      << " iterations, " << dur4 << "s, "
+      << counter.allocations-allocations << " upstream allocations" << endl;
+  }
+
+  // MINRES on a symmetric indefinite operator
+  {
+    TridiagonalOperator<PoolVector> A(n, -1.0, 3.0, -1.0, true);
+    KrylovWorkspace<PoolVector> ws(20, PoolVector::allocator_type(&pool));
+    PoolVector x{PoolVector::allocator_type(&pool)};
+    const size_t allocations=counter.allocations;
+    clock_t start(clock());
+    const bool converged=MINRES(A, bpool, x, ws, tol, maxit, iterations);
+    const double dur=(clock() - start) / (double) CLOCKS_PER_SEC;
+    cout << "- MINRES " << (converged ? "converged" : "did not converge")
+      << " after " << iterations << " iterations, relative residual "
+      << residual_norm(A, bpool, x) << ", " << dur << "s, "
+      << counter.allocations-allocations << " upstream allocations" << endl;
+  }
+
+  // GMRES(20) on a nonsymmetric operator
+  {
+    TridiagonalOperator<PoolVector> A(n, -1.3, 2.1, -0.7);
+    KrylovWorkspace<PoolVector> ws(20, PoolVector::allocator_type(&pool));
+    PoolVector x{PoolVector::allocator_type(&pool)};
+    const size_t allocations=counter.allocations;
+    clock_t start(clock());
+    const bool converged=GMRES(A, bpool, x, ws, tol, maxit, iterations);
+    const double dur=(clock() - start) / (double) CLOCKS_PER_SEC;
+    cout << "- GMRES(20) " << (converged ? "converged" : "did not converge")
+      << " after " << iterations << " iterations, relative residual "
+      << residual_norm(A, bpool, x) << ", " << dur << "s, "
+      << counter.allocations-allocations << " upstream allocations" << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,318 @@
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <time.h>
+
+/*
+ Wavelet-Galerkin discretizations of elliptic problems are typically
+ preconditioned by the diagonal scaling D^{-1}, D=diag(2^{js}), where j is the
+ level of the wavelet index lambda=(j,k) and s is the order of the operator.
+ A literal implementation walks through the vector and calls pow(2,-j*s) for
+ every single entry, although all entries on the same level share the same
+ factor, and there are only a few dozens of levels.
+
+ In this design test program, we compare two level-aware implementations of
+ scale_by_level(s), i.e., v_lambda *= 2^{-|lambda|s}, and of its inverse
+ unscale_by_level(s), i.e., v_lambda *= 2^{|lambda|s}:
+ 1) InfiniteVector with keys (j,k) and an arbitrary CONTAINER: the factor is
+    only recomputed (or fetched from a small table) when the level changes
+    from one entry to the next. With the lexicographical ordering of
+    Key_Compare, all entries of one level are stored consecutively, so that
+    there is exactly one pow() per level. For hashed containers, the table
+    still avoids the pow() calls.
+ 2) LevelBucketedVector stores the translations and the values of every level
+    in separate contiguous arrays. Here, scaling is a sequence of plain loops,
+    one per level, multiplying an array by one precomputed factor, which the
+    compiler can vectorize.
+ */
+
+using std::cout;
+using std::endl;
+
+// a wavelet index (j,k) with level j and translation k
+class Key
+{
+public:
+  int j, k;
+
+  Key(int x, int y)
+  : j(x), k(y)
+  {
+  }
+
+  bool operator == (const Key& vgl) const
+  {
+    return (j == vgl.j && k == vgl.k);
+  }
+};
+
+// lexicographical comparison, all indices on one level are consecutive
+struct Key_Compare
+{
+  bool operator() (const Key& lhs, const Key& rhs) const
+  {
+    return ((lhs.j < rhs.j) || ((lhs.j == rhs.j) && (lhs.k < rhs.k)));
+  }
+};
+
+struct Key_Hash
+{
+  size_t operator() (const Key& key) const
+  {
+    return std::hash<long>()((long(key.j) << 32) + key.k);
+  }
+};
+
+template <class C, class I=Key, class CONTAINER=std::map<I,C,Key_Compare> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  typedef typename CONTAINER::const_iterator const_iterator;
+  typedef typename CONTAINER::value_type value_type;
+
+  const_iterator begin() const
+  {
+    return CONTAINER::begin();
+  }
+
+  const_iterator end() const
+  {
+    return CONTAINER::end();
+  }
+
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  C get_coefficient(const I& index) const
+  {
+    const_iterator it(CONTAINER::find(index));
+    return (it == CONTAINER::end() ? C(0) : it->second);
+  }
+
+  void set_coefficient(const I& index, const C value)
+  {
+    CONTAINER::operator [] (index) = value;
+  }
+
+  // v_lambda *= 2^{-|lambda|*s}
+  void scale_by_level(const double s)
+  {
+    // 2^{-j*s} for the levels j visited so far; a separate flag marks the
+    // computed factors, since 2^{-j*s} may underflow to zero
+    std::vector<double> factors;
+    std::vector<char> computed;
+    bool first(true);
+    int level(0);
+    C factor(1);
+    for (typename CONTAINER::iterator it(CONTAINER::begin()); it != CONTAINER::end(); ++it)
+    {
+      if (first || it->first.j != level)
+      {
+        first = false;
+        level = it->first.j;
+        assert(level >= 0);
+        if (level < 0)
+        {
+          // not in the table, which would be out of bounds in release builds
+          factor = pow(2.0, -level*s);
+        }
+        else
+        {
+          if (level >= int(factors.size()))
+          {
+            factors.resize(level+1);
+            computed.resize(level+1, 0);
+          }
+          if (!computed[level])
+          {
+            factors[level] = pow(2.0, -level*s);
+            computed[level] = 1;
+          }
+          factor = factors[level];
+        }
+      }
+      it->second *= factor;
+    }
+  }
+
+  // v_lambda *= 2^{|lambda|*s}
+  void unscale_by_level(const double s)
+  {
+    scale_by_level(-s);
+  }
+};
+
+/*
+ A vector of (j,k)-indexed coefficients, the indices and values on each level
+ being stored in separate contiguous arrays, sorted by translation.
+ */
+template <class C>
+class LevelBucketedVector
+{
+public:
+  struct Level
+  {
+    std::vector<int> translations;
+    std::vector<C> values;
+  };
+
+  // number of levels 0,...,maxlevel() which may contain entries
+  size_t levels() const
+  {
+    return _levels.size();
+  }
+
+  const Level& level(const int j) const
+  {
+    return _levels[j];
+  }
+
+  size_t size() const
+  {
+    size_t r(0);
+    for (size_t j = 0; j < _levels.size(); j++)
+      r += _levels[j].values.size();
+    return r;
+  }
+
+  C get_coefficient(const Key& index) const
+  {
+    if (index.j < 0 || index.j >= int(_levels.size()))
+      return C(0);
+    const Level& level(_levels[index.j]);
+    std::vector<int>::const_iterator it
+      (std::lower_bound(level.translations.begin(), level.translations.end(), index.k));
+    return (it != level.translations.end() && *it == index.k
+            ? level.values[it - level.translations.begin()] : C(0));
+  }
+
+  // levels j<0 cannot be stored, such entries are ignored
+  void set_coefficient(const Key& index, const C value)
+  {
+    assert(index.j >= 0);
+    if (index.j < 0)
+      return;
+    if (index.j >= int(_levels.size()))
+      _levels.resize(index.j+1);
+    Level& level(_levels[index.j]);
+    std::vector<int>::iterator it
+      (std::lower_bound(level.translations.begin(), level.translations.end(), index.k));
+    const size_t pos(it - level.translations.begin());
+    if (it != level.translations.end() && *it == index.k)
+    {
+      level.values[pos] = value;
+    }
+    else
+    {
+      level.translations.insert(it, index.k);
+      level.values.insert(level.values.begin()+pos, value);
+    }
+  }
+
+  // v_lambda *= 2^{-|lambda|*s}, one factor and one vectorizable loop per level
+  void scale_by_level(const double s)
+  {
+    for (size_t j = 0; j < _levels.size(); j++)
+    {
+      const C factor(pow(2.0, -int(j)*s));
+      C* values(_levels[j].values.data());
+      const size_t n(_levels[j].values.size());
+      for (size_t i = 0; i < n; i++)
+        values[i] *= factor;
+    }
+  }
+
+  // v_lambda *= 2^{|lambda|*s}
+  void unscale_by_level(const double s)
+  {
+    scale_by_level(-s);
+  }
+
+private:
+  std::vector<Level> _levels;
+};
+
+// the literal implementation with one pow() per entry
+template <class VECTOR>
+void scale_by_level_with_pow(VECTOR& v, const double s)
+{
+  for (typename VECTOR::const_iterator it(v.begin()); it != v.end(); ++it)
+    v.set_coefficient(it->first, it->second * pow(2.0, -it->first.j*s));
+}
+
+int main()
+{
+  // a sparse set of wavelet coefficients on the levels 0,...,J
+  const int J=16;
+  const double s=1.5;
+  InfiniteVector<double> v;
+  InfiniteVector<double,Key,std::unordered_map<Key,double,Key_Hash> > u;
+  LevelBucketedVector<double> w;
+  for (int j=0; j<=J; j++)
+    for (int k=0; k<(1<<j); k++)
+      if ((7*k+j)%3 == 0)
+      {
+        const double value=1.0+(k%5);
+        v.set_coefficient(Key(j,k), value);
+        u.set_coefficient(Key(j,k), value);
+        w.set_coefficient(Key(j,k), value);
+      }
+  cout << "- number of coefficients: " << v.size() << " on " << w.levels() << " levels" << endl;
+
+  InfiniteVector<double> v0(v);
+  const int repetitions=20;
+
+  clock_t start=clock();
+  for (int r=0; r<repetitions; r++)
+    scale_by_level_with_pow(v0, s);
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    v.scale_by_level(s);
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    u.scale_by_level(s);
+  const double dur3=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    w.scale_by_level(s);
+  const double dur4=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  bool equal=true;
+  for (InfiniteVector<double>::const_iterator it(v0.begin()); it != v0.end(); ++it)
+    equal = equal && (v.get_coefficient(it->first) == it->second)
+      && (u.get_coefficient(it->first) == it->second)
+      && (w.get_coefficient(it->first) == it->second);
+  cout << "- all level scalings agree with the one using pow() per entry? "
+    << (equal ? "yes" : "no") << endl;
+
+  // the inverse scaling restores the original coefficients (up to roundoff)
+  for (int r=0; r<repetitions; r++)
+  {
+    v.unscale_by_level(s);
+    w.unscale_by_level(s);
+  }
+  double error=0;
+  for (InfiniteVector<double>::const_iterator it(v.begin()); it != v.end(); ++it)
+    error = std::max(error, std::max(fabs(it->second-(1.0+(it->first.k%5))),
+                                     fabs(w.get_coefficient(it->first)-(1.0+(it->first.k%5)))));
+  cout << "- maximal deviation after scaling and unscaling: " << error << endl;
+
+  cout << "\nscaling with pow() per entry: " << dur1 << "s\n";
+  cout << "scaling level by level, std::map with Key_Compare: " << dur2 << "s\n";
+  cout << "scaling level by level, std::unordered_map: " << dur3 << "s\n";
+  cout << "scaling level by level, level-bucketed arrays: " << dur4 << "s\n";
+
+  return 0;
+}
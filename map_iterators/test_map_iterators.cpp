@@ -2,6 +2,14 @@
 #include <map>
 #include <unordered_map>
 #include <algorithm>
+#include <vector>
+#include <span>
+#include <ranges>
+#include <iterator>
+#include <execution>
+#include <utility>
+#include <cassert>
+#include <time.h>
 
 /*
  As one of the core ingredients of the AMSTeL library, we will use a C++
@@ -39,6 +47,26 @@
     entries.
  3) We enable the user to exchange the base container class by a third
     template argument CONTAINER, defaulting to std::map<I,C>.
+ 4) If the iterators of CONTAINER are random access iterators (or even
+    contiguous ones), as for the flat backend FlatMap, a sorted std::vector of
+    (index,value) pairs, then so are the iterators of InfiniteVector. This way,
+    the parallel algorithms from <algorithm> (with std::execution::par_unseq)
+    can split the range in O(1) instead of walking through it. In that case,
+    InfiniteVector also exposes its entries as a std::span, and the indices
+    and values as random access views.
+ 5) Pipelines which produce a CONTAINER (or sorted buffers of indices and
+    values) and wrap it into an InfiniteVector should not pay for a deep copy.
+    Therefore, InfiniteVector can adopt an rvalue CONTAINER by moving it,
+    release() hands the CONTAINER back (leaving an empty vector behind), and
+    the constructor with the tag sorted_unique appends already sorted entries
+    in O(1) each, without searching or re-sorting them. FlatMap can even
+    adopt a sorted std::vector of pairs without touching the entries.
+ 6) Loops like for (it=v.begin(); it!=v.end(); ++it) should compare against a
+    cheap end marker. Besides end(), which is still needed by the algorithms
+    from <algorithm> (they require both ends of the same type), InfiniteVector
+    offers sentinel(), which only stores the end state of CONTAINER, and the
+    range [begin(),sentinel()) via range(), for the algorithms in std::ranges.
+    Compile with -O2 -S and inspect sum_values() to see the tight loop.
  
  Thorsten Raasch, November 2018 and March 2023
  */
@@ -46,9 +74,108 @@
 using std::cout;
 using std::endl;
 
+// tag for constructors which take entries with strictly increasing indices
+struct sorted_unique_t
+{
+  explicit sorted_unique_t() = default;
+};
+inline constexpr sorted_unique_t sorted_unique{};
+
+/*
+ A flat associative container: a std::vector of (index,value) pairs, sorted by
+ the index. Lookups are O(log N) by binary search, inserting a new index costs
+ O(N), but the iterators are contiguous.
+ */
+template <class I, class C>
+class FlatMap
+  : protected std::vector<std::pair<I,C> >
+{
+public:
+  typedef std::vector<std::pair<I,C> > Base;
+  typedef I key_type;
+  typedef C mapped_type;
+  typedef typename Base::value_type value_type;
+  typedef typename Base::iterator iterator;
+  typedef typename Base::const_iterator const_iterator;
+
+  using Base::begin;
+  using Base::end;
+  using Base::size;
+  using Base::empty;
+  using Base::reserve;
+
+  FlatMap()
+  : Base()
+  {
+  }
+
+  // adopt a vector of entries with strictly increasing indices, without copying
+  FlatMap(sorted_unique_t, Base&& entries)
+  : Base(std::move(entries))
+  {
+    assert(std::adjacent_find(begin(), end(),
+                              [] (const value_type& a, const value_type& b)
+                              { return !(a.first < b.first); }) == end());
+  }
+
+  const_iterator lower_bound(const I& index) const
+  {
+    return std::lower_bound(begin(), end(), index,
+                            [] (const value_type& entry, const I& i) { return entry.first < i; });
+  }
+
+  const_iterator find(const I& index) const
+  {
+    const_iterator it(lower_bound(index));
+    return (it != end() && it->first == index ? it : end());
+  }
+
+  C& operator [] (const I& index)
+  {
+    iterator it(begin() + (lower_bound(index) - begin()));
+    if (it == end() || it->first != index)
+      it = Base::insert(it, value_type(index, C()));
+    return it->second;
+  }
+
+  // insert a new entry at the position hint, which has to be the correct one
+  iterator emplace_hint(const_iterator hint, const I& index, const C& value)
+  {
+    return Base::emplace(hint, index, value);
+  }
+};
+
 // forward declaration of InfiniteVector iterators
 template <class C, class I, class CONTAINER> class InfiniteVectorConstIterator;
 
+/*
+ The end marker of an InfiniteVector: it only stores the end state of
+ CONTAINER, so that comparing against it is a comparison of two plain
+ CONTAINER iterators.
+ */
+template <class C, class I, class CONTAINER>
+class InfiniteVectorSentinel
+{
+public:
+  InfiniteVectorSentinel()
+  : _end()
+  {
+  }
+
+  explicit InfiniteVectorSentinel(typename CONTAINER::const_iterator end)
+  : _end(end)
+  {
+  }
+
+  const typename CONTAINER::const_iterator& state() const
+  {
+    return _end;
+  }
+
+private:
+  typename CONTAINER::const_iterator _end;
+};
+
 template <class C, class I=int, class CONTAINER=std::map<I,C> >
 class InfiniteVector
   : protected CONTAINER
@@ -56,6 +183,7 @@ class InfiniteVector
 public:
   friend class InfiniteVectorConstIterator<C,I,CONTAINER>;
   typedef InfiniteVectorConstIterator<C,I,CONTAINER> const_iterator;
+  typedef InfiniteVectorSentinel<C,I,CONTAINER> sentinel_type;
   
   typedef typename CONTAINER::value_type value_type;
   
@@ -69,6 +197,33 @@ public:
   {
   }
   
+  // adopt the storage of source, which is left empty
+  InfiniteVector(CONTAINER&& source)
+  : CONTAINER(std::move(source))
+  {
+  }
+  
+  // construct from buffers with strictly increasing indices, without sorting
+  InfiniteVector(sorted_unique_t, std::span<const I> indices, std::span<const C> values)
+  : CONTAINER()
+  {
+    assert(indices.size() == values.size());
+    assert(std::adjacent_find(indices.begin(), indices.end(),
+                              [] (const I& a, const I& b) { return !(a < b); }) == indices.end());
+    if constexpr (requires (CONTAINER& c, size_t n) { c.reserve(n); })
+      CONTAINER::reserve(indices.size());
+    for (size_t k = 0; k < indices.size(); k++)
+      CONTAINER::emplace_hint(CONTAINER::end(), indices[k], values[k]);
+  }
+  
+  // hand back the underlying storage, *this is left as a zero vector
+  CONTAINER release()
+  {
+    CONTAINER r(std::move(static_cast<CONTAINER&>(*this)));
+    CONTAINER::clear();
+    return r;
+  }
+  
   const_iterator begin() const
   {
     return const_iterator(*this, CONTAINER::begin());
@@ -78,11 +233,41 @@ public:
   {
     return const_iterator(*this, CONTAINER::end());
   };
+
+  // cheap end marker for loops and for the algorithms in std::ranges
+  sentinel_type sentinel() const
+  {
+    return sentinel_type(CONTAINER::end());
+  }
+
+  // the whole vector as a range [begin(),sentinel())
+  std::ranges::subrange<const_iterator, sentinel_type> range() const
+  {
+    return std::ranges::subrange<const_iterator, sentinel_type>(begin(), sentinel());
+  }
   
   size_t size() const
   {
     return CONTAINER::size();
   };
+
+  // the entries as a contiguous array, if CONTAINER allows it
+  std::span<const value_type> entries() const
+    requires std::contiguous_iterator<typename CONTAINER::const_iterator>
+  {
+    return std::span<const value_type>(CONTAINER::begin(), CONTAINER::end());
+  }
+
+  // views on the indices and values, random access if CONTAINER allows it
+  auto indices() const
+  {
+    return std::ranges::subrange(begin(), end()) | std::views::keys;
+  }
+
+  auto values() const
+  {
+    return std::ranges::subrange(begin(), end()) | std::views::values;
+  }
   
   bool operator == (const InfiniteVector<C,I,CONTAINER>& v) const
   {
@@ -133,21 +318,43 @@ public:
   typedef typename CONTAINER::const_iterator::value_type value_type;
   typedef typename CONTAINER::const_iterator::pointer pointer;
   typedef typename CONTAINER::const_iterator::reference reference;
+  // the iterator_category of a contiguous iterator is random access
+  typedef std::conditional_t<std::contiguous_iterator<typename CONTAINER::const_iterator>,
+                             std::contiguous_iterator_tag, iterator_category> iterator_concept;
   
 private:
-  const InfiniteVector<C,I,CONTAINER>& _container;
+  // a pointer (instead of a reference), so that iterators are assignable
+  const InfiniteVector<C,I,CONTAINER>* _container;
+  
+  static constexpr bool random_access
+    = std::random_access_iterator<typename CONTAINER::const_iterator>;
+  
+  const typename CONTAINER::const_iterator& state() const
+  {
+    return static_cast<const typename CONTAINER::const_iterator&>(*this);
+  }
   
 public:
+  InfiniteVectorConstIterator()
+  : CONTAINER::const_iterator(), _container(nullptr)
+  {
+  }
+  
   InfiniteVectorConstIterator(const InfiniteVector<C,I,CONTAINER>& container,
                               typename CONTAINER::const_iterator state)
-  : CONTAINER::const_iterator(state), _container(container)
+  : CONTAINER::const_iterator(state), _container(&container)
   {
   }
 
   bool operator == (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
   {
-    return (static_cast<typename CONTAINER::const_iterator>(*this)
-            == static_cast<typename CONTAINER::const_iterator>(it));
+    return (state() == it.state());
+  }
+
+  // comparison with the end marker; != and the reversed versions are generated by C++20
+  bool operator == (const InfiniteVectorSentinel<C,I,CONTAINER>& s) const
+  {
+    return (state() == s.state());
   }
   
   bool operator != (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
@@ -181,6 +388,78 @@ public:
     return r;
   }
   
+  // random access, only available if CONTAINER::const_iterator supports it
+  InfiniteVectorConstIterator<C,I,CONTAINER>& operator += (const difference_type n)
+    requires random_access
+  {
+    CONTAINER::const_iterator::operator += (n);
+    return *this;
+  }
+  
+  InfiniteVectorConstIterator<C,I,CONTAINER>& operator -= (const difference_type n)
+    requires random_access
+  {
+    CONTAINER::const_iterator::operator -= (n);
+    return *this;
+  }
+  
+  InfiniteVectorConstIterator<C,I,CONTAINER> operator + (const difference_type n) const
+    requires random_access
+  {
+    InfiniteVectorConstIterator<C,I,CONTAINER> r(*this);
+    return (r += n);
+  }
+  
+  friend InfiniteVectorConstIterator<C,I,CONTAINER>
+  operator + (const difference_type n, const InfiniteVectorConstIterator<C,I,CONTAINER>& it)
+    requires random_access
+  {
+    return it + n;
+  }
+  
+  InfiniteVectorConstIterator<C,I,CONTAINER> operator - (const difference_type n) const
+    requires random_access
+  {
+    InfiniteVectorConstIterator<C,I,CONTAINER> r(*this);
+    return (r -= n);
+  }
+  
+  difference_type operator - (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+    requires random_access
+  {
+    return state() - it.state();
+  }
+  
+  reference operator [] (const difference_type n) const
+    requires random_access
+  {
+    return state()[n];
+  }
+  
+  bool operator < (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+    requires random_access
+  {
+    return state() < it.state();
+  }
+  
+  bool operator > (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+    requires random_access
+  {
+    return it < *this;
+  }
+  
+  bool operator <= (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+    requires random_access
+  {
+    return !(it < *this);
+  }
+  
+  bool operator >= (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+    requires random_access
+  {
+    return !(*this < it);
+  }
+  
   const I& index() const
   {
     return (CONTAINER::const_iterator::operator * ()).first;
@@ -244,8 +523,49 @@ private:
   typename Pair::second_type value_;
 };
 
+// sum of all values, as a plain loop against the end marker
+template <class VECTOR>
+double sum_values(const VECTOR& v)
+{
+  double r(0);
+  for (typename VECTOR::const_iterator it(v.begin()); it != v.sentinel(); ++it)
+    r += it.value();
+  return r;
+}
+
+// the same sum, comparing against end() in every step
+template <class VECTOR>
+double sum_values_end(const VECTOR& v)
+{
+  double r(0);
+  for (typename VECTOR::const_iterator it(v.begin()); it != v.end(); ++it)
+    r += it.value();
+  return r;
+}
+
+template <class VECTOR>
+void benchmark_sentinel(const char* name, const VECTOR& v, const int repetitions)
+{
+  double r1=0, r2=0;
+  clock_t start=clock();
+  for (int r=0; r<repetitions; r++)
+    r1 += sum_values_end(v);
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    r2 += sum_values(v);
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << name << ": against end() " << dur1 << "s, against sentinel() " << dur2 << "s"
+    << (r1 == r2 ? "" : " (results differ!)") << "\n";
+}
+
 int main()
 {
+  static_assert(std::sentinel_for<InfiniteVector<double,int>::sentinel_type,
+                                  InfiniteVector<double,int>::const_iterator>);
+  static_assert(std::ranges::bidirectional_range<decltype(std::declval<const InfiniteVector<double,int>&>().range())>);
+  static_assert(std::ranges::random_access_range<decltype(std::declval<const InfiniteVector<double,int,FlatMap<int,double> >&>().range())>);
+
   InfiniteVector<double,int> v; // default CONTAINER=std::map<I,C>
   InfiniteVector<double,int,std::unordered_map<int,double> > z; // custom choice of CONTAINER
   
@@ -271,6 +591,27 @@ int main()
   cout << "- a vector u created via std::unordered_map :" << endl
     << u;
 
+  // test constructor from a flat CONTAINER
+  FlatMap<int,double> fmap;
+  fmap[123]=23.0;
+  fmap[42]=23.0;
+  InfiniteVector<double,int,FlatMap<int,double> > f(fmap), g(fmap);
+  cout << "- a vector f created via FlatMap :" << endl
+    << f;
+
+  // check the iterator categories
+  cout << "- are the iterators of w random access / contiguous? "
+    << (std::random_access_iterator<InfiniteVector<double,int>::const_iterator> ? "yes" : "no") << " / "
+    << (std::contiguous_iterator<InfiniteVector<double,int>::const_iterator> ? "yes" : "no") << endl;
+  cout << "- are the iterators of f random access / contiguous? "
+    << (std::random_access_iterator<InfiniteVector<double,int,FlatMap<int,double> >::const_iterator> ? "yes" : "no") << " / "
+    << (std::contiguous_iterator<InfiniteVector<double,int,FlatMap<int,double> >::const_iterator> ? "yes" : "no") << endl;
+
+  // test the span and view accessors
+  cout << "- the entries of f as a span have size " << f.entries().size()
+    << ", the last index is " << f.indices()[f.size()-1]
+    << " and the last value is " << f.values()[f.size()-1] << endl;
+
   // test operator == on AnotherInfiniteVector
   AnotherInfiniteVector<double,int> a,b; // container class is public
   a[1]=2.5;
@@ -312,5 +653,85 @@ int main()
   << std::count_if(u.begin(), u.end(), second_equal_to<InfiniteVector<double,int,std::unordered_map<int,double> >::value_type>(number))
   << " times the number " << number << endl;
 
+  // test std::count_if() algorithm for InfiniteVector with flat container
+  cout << "- f contains "
+  << std::count_if(f.begin(), f.end(), second_equal_to<InfiniteVector<double,int,FlatMap<int,double> >::value_type>(number))
+  << " times the number " << number << endl;
+
+  // test parallel algorithms, for std::map and for the flat container
+  cout << "- w contains (parallel count) "
+  << std::count_if(std::execution::par_unseq, w.begin(), w.end(),
+                   [number] (const InfiniteVector<double,int>::value_type& p) { return p.second == number; })
+  << " times the number " << number << endl;
+  cout << "- f contains (parallel count) "
+  << std::count_if(std::execution::par_unseq, f.begin(), f.end(),
+                   [number] (const InfiniteVector<double,int,FlatMap<int,double> >::value_type& p) { return p.second == number; })
+  << " times the number " << number << endl;
+  cout << "- are the vectors f and g equal (parallel comparison)?" << endl;
+  if (std::equal(std::execution::par_unseq, f.begin(), f.end(), g.begin(), g.end()))
+    cout << "  ... yes!" << endl;
+  else
+    cout << "  ... no!" << endl;
+
+  // test zero-copy handoff of a large std::map
+  const int N=1000000;
+  std::map<int,double> bigmap;
+  std::vector<int> bigindices(N);
+  std::vector<double> bigvalues(N);
+  for (int k=0; k<N; k++)
+  {
+    bigindices[k]=2*k;
+    bigvalues[k]=1.0+k%3;
+    bigmap.emplace_hint(bigmap.end(), bigindices[k], bigvalues[k]);
+  }
+  clock_t start=clock();
+  InfiniteVector<double,int> bigcopy(bigmap);
+  const double dur_copy=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  InfiniteVector<double,int> big(std::move(bigmap));
+  const double dur_move=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << "- wrapping a std::map with " << N << " entries: copy " << dur_copy
+    << "s, move " << dur_move << "s" << endl;
+  std::map<int,double> released(big.release());
+  cout << "- after release(), the vector has " << big.size()
+    << " entries and the released std::map has " << released.size() << endl;
+
+  // test construction from sorted buffers
+  start=clock();
+  InfiniteVector<double,int> sorted(sorted_unique, bigindices, bigvalues);
+  const double dur_sorted=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  InfiniteVector<double,int,FlatMap<int,double> > flatsorted(sorted_unique, bigindices, bigvalues);
+  const double dur_flatsorted=(clock() - start) / (double) CLOCKS_PER_SEC;
+  std::vector<std::pair<int,double> > entries(N);
+  for (int k=0; k<N; k++)
+    entries[k]=std::make_pair(bigindices[k], bigvalues[k]);
+  const std::pair<int,double>* data=entries.data();
+  start=clock();
+  InfiniteVector<double,int,FlatMap<int,double> > adopted(FlatMap<int,double>(sorted_unique, std::move(entries)));
+  const double dur_adopted=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << "- construction from sorted buffers: std::map " << dur_sorted
+    << "s, FlatMap " << dur_flatsorted << "s, FlatMap adopting a vector " << dur_adopted << "s" << endl;
+  cout << "- is the adopted vector stored in place? "
+    << (adopted.entries().data() == data ? "yes" : "no") << endl;
+  cout << "- do all constructions give the same vector? "
+    << (sorted == bigcopy && std::equal(flatsorted.begin(), flatsorted.end(), bigcopy.begin(), bigcopy.end(),
+                  [] (const auto& a, const auto& b) { return a.first == b.first && a.second == b.second; })
+        && std::equal(adopted.begin(), adopted.end(), flatsorted.begin(), flatsorted.end()) ? "yes" : "no")
+    << endl;
+
+  // test the sentinel
+  cout << "- the number of entries of w, counted against the sentinel: "
+    << std::ranges::distance(w.range()) << endl;
+  cout << "- w contains (count via std::ranges) "
+    << std::ranges::count_if(w.range(), second_equal_to<InfiniteVector<double,int>::value_type>(number))
+    << " times the number " << number << endl;
+  cout << "- are the vectors f and g equal (comparison via std::ranges)? "
+    << (std::ranges::equal(f.range(), g.range()) ? "yes" : "no") << endl;
+
+  cout << endl;
+  benchmark_sentinel("std::map", bigcopy, 10);
+  benchmark_sentinel("FlatMap", flatsorted, 10);
+
   return 0;
 }
@@ -0,0 +1,43 @@
+// -*- c++ -*-
+
+#ifndef _AMSTEL_HASH_MIX_H
+#define _AMSTEL_HASH_MIX_H
+
+#include <cstdint>
+
+/*
+ A bijective mixing function for 64-bit integers, with two multiplications
+ and three xor-shifts (the finalizer of degski64, similar to that of
+ splitmix64), after which every input bit affects all output bits.
+ The hash functions for tuple keys (see map_tuple_keys/test_map_hash.cpp)
+ and for wavelet indices (see wavelet_index/wavelet_index.h) pack their
+ components into 64 bits (tuple keys with hash_pack2() or hash_pack3()) and
+ mix them with hash_mix(), so that they can be used in hash tables with
+ power-of-two sizes, which just take the lower bits.
+ */
+
+constexpr uint64_t hash_mix(uint64_t x)
+{
+  x ^= x >> 32;
+  x *= 0xD6E8FEB86659FD93ull;
+  x ^= x >> 32;
+  x *= 0xD6E8FEB86659FD93ull;
+  x ^= x >> 32;
+  return x;
+}
+
+// the two components of a 2D key, in the upper and the lower word
+constexpr uint64_t hash_pack2(const int j, const int k)
+{
+  return (uint64_t(uint32_t(j)) << 32) | uint32_t(k);
+}
+
+// the first two components as in hash_pack2(), with the third one
+// multiplied by an odd constant (2^64/golden ratio) and xored in, which
+// spreads it over all 64 bits
+constexpr uint64_t hash_pack3(const int j, const int k, const int l)
+{
+  return hash_pack2(j, k) ^ (uint64_t(uint32_t(l)) * 0x9E3779B97F4A7C15ull);
+}
+
+#endif
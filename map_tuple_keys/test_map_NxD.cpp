@@ -0,0 +1,292 @@
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <array>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <time.h>
+#include <math.h>
+#include "benchmark_harness/benchmark_harness.h"
+#include "access_patterns/access_patterns.h"
+
+/*
+ In this file, we generalize the enumerations nr() of test_map_NxN.cpp and
+ test_map_NxNxN.cpp to D-tuples (x_0,...,x_{D-1}) of nonnegative integers,
+ as they occur for tensor-product wavelet bases on D-dimensional domains.
+ With the partial sums S_m=x_0+...+x_{m-1}, the enumeration function
+   nr(x)=binomial(S_1,1)+binomial(S_2+1,2)+...+binomial(S_D+D-1,D)
+ is a bijection onto the nonnegative integers, since
+   S_1 < S_2+1 < ... < S_D+D-1
+ is the representation of nr(x) in the combinatorial number system of degree D.
+ The tuples are enumerated simplex by simplex, i.e., by increasing S_D.
+ For D=2 and D=3, nr() coincides with the hand-coded functions
+   nr(j,k)=(j+k)*(j+k+1)/2+j,
+   nr(j,k,l)=((j+k+l)^3+3*(j+k+l)^2+2*(j+k+l))/6+((j+k)*(j+k+1))/2+j.
+ The binomial coefficients are taken from a table which is computed at
+ compile time, so that nr() costs D table lookups and additions, without any
+ floating-point arithmetic. The inverse Key<D>::from_nr() determines the
+ partial sums from D to 1 by binary searches in the rows of the table.
+ The maps with Key<3> and with its numbers are read both in row-major order
+ and with the key streams of access_patterns.h, the latter in the benchmark
+ harness (see benchmark_harness/benchmark_harness.h).
+ */
+
+using std::cout;
+using std::endl;
+
+// the binomial coefficients binomial(n,m) for 0<=n<NMAX and 0<=m<=D
+template <unsigned int D, int NMAX>
+struct BinomialTable
+{
+  long int entries[D+1][NMAX];
+
+  constexpr BinomialTable()
+  : entries()
+  {
+    for (int n = 0; n < NMAX; n++)
+    {
+      entries[0][n] = 1;
+      for (unsigned int m = 1; m <= D; m++)
+        entries[m][n] = (n == 0 ? 0 : entries[m][n-1] + entries[m-1][n-1]);
+    }
+  }
+
+  constexpr long int operator () (const int n, const unsigned int m) const
+  {
+    return entries[m][n];
+  }
+};
+
+// a D-tuple of nonnegative integers, enumerated simplex by simplex
+template <unsigned int D>
+class Key
+{
+  static_assert(D >= 1 && D <= 6, "the binomial table overflows for D>6");
+
+public:
+  // bound for S_D+D-1; binomial(4095,6) still fits into a long int
+  static constexpr int NMAX = 4096;
+  static constexpr BinomialTable<D,NMAX> binomials = BinomialTable<D,NMAX>();
+
+  std::array<int,D> x;
+
+  constexpr Key()
+  : x()
+  {
+  }
+
+  template <class... INTS>
+    requires (sizeof...(INTS) == D)
+  constexpr Key(const INTS... coordinates)
+  : x{{coordinates...}}
+  {
+  }
+
+  constexpr int& operator [] (const unsigned int m)
+  {
+    return x[m];
+  }
+
+  constexpr const int& operator [] (const unsigned int m) const
+  {
+    return x[m];
+  }
+
+  constexpr long int nr() const
+  {
+    long int r(0);
+    int S(0);
+    for (unsigned int m = 1; m <= D; m++)
+    {
+      S += x[m-1];
+      assert(S+int(m)-1 < NMAX);
+      r += binomials(S+m-1, m);
+    }
+    return r;
+  }
+
+  // the inverse of nr()
+  static constexpr Key<D> from_nr(long int n)
+  {
+    Key<D> r;
+    int upper(NMAX); // the combination S_m+m-1 is strictly decreasing in m
+    for (unsigned int m = D; m >= 1; m--)
+    {
+      // find the largest c < upper with binomial(c,m) <= n
+      int low(m-1), high(upper);
+      while (high-low > 1)
+      {
+        const int middle((low+high)/2);
+        if (binomials(middle, m) <= n)
+          low = middle;
+        else
+          high = middle;
+      }
+      n -= binomials(low, m);
+      r.x[m-1] = low-(m-1); // S_m, converted to x[m-1] below
+      upper = low;
+    }
+    for (unsigned int m = D-1; m >= 1; m--)
+      r.x[m] -= r.x[m-1];
+    return r;
+  }
+
+  constexpr bool operator == (const Key<D>& vgl) const
+  {
+    return x == vgl.x;
+  }
+};
+
+template <unsigned int D>
+std::ostream& operator << (std::ostream& os, const Key<D>& key)
+{
+  os << '(';
+  for (unsigned int m = 0; m < D; m++)
+    os << (m > 0 ? "," : "") << key[m];
+  os << ')';
+  return os;
+}
+
+// lexicographical comparison of two tuples
+template <unsigned int D>
+struct Key_Compare
+{
+  bool operator() (const Key<D>& lhs, const Key<D>& rhs) const
+  {
+    return lhs.x < rhs.x;
+  }
+};
+
+// sorting Keys with nr()
+template <unsigned int D>
+struct Key_Compare2
+{
+  bool operator() (const Key<D>& lhs, const Key<D>& rhs) const
+  {
+    return lhs.nr() < rhs.nr();
+  }
+};
+
+static_assert(Key<2>(1,0).nr() == 2 && Key<2>(0,2).nr() == 3);
+static_assert(Key<3>(0,0,1).nr() == 1 && Key<3>(0,1,0).nr() == 2 && Key<3>(1,0,0).nr() == 3);
+static_assert(Key<6>::from_nr(Key<6>(1,2,3,4,5,6).nr()) == Key<6>(1,2,3,4,5,6));
+
+// check that from_nr() inverts nr() on [0,n), and that nr() enumerates the simplices in order
+template <unsigned int D>
+bool check_enumeration(const long int n)
+{
+  int last_sum(0);
+  for (long int i = 0; i < n; i++)
+  {
+    const Key<D> key(Key<D>::from_nr(i));
+    int sum(0);
+    for (unsigned int m = 0; m < D; m++)
+    {
+      if (key[m] < 0)
+        return false;
+      sum += key[m];
+    }
+    if (key.nr() != i || sum < last_sum)
+      return false;
+    last_sum = sum;
+  }
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  cout << "- the first tuples for D=3:";
+  for (long int i = 0; i < 10; i++)
+    cout << " " << Key<3>::from_nr(i);
+  cout << endl;
+
+  // compare with the hand-coded enumerations
+  bool agree(true);
+  for (int j = 0; j < 100; j++)
+    for (int k = 0; k < 100; k++)
+    {
+      agree = agree && Key<2>(j,k).nr() == (j+k)*(j+k+1)/2+j;
+      for (int l = 0; l < 100; l++)
+        agree = agree && Key<3>(j,k,l).nr()
+          == (long int)(pow(j+k+l,3)+pow(j+k+l,2)*3+(j+k+l)*2)/6+((j+k)*(j+k+1))/2+j;
+    }
+  cout << "- does Key<D>::nr() agree with the hand-coded nr() for D=2,3? " << (agree ? "yes" : "no") << endl;
+
+  const long int n=100000;
+  cout << "- is from_nr() the inverse of nr() on [0," << n << ") for D=2,...,6? "
+    << (check_enumeration<2>(n) && check_enumeration<3>(n) && check_enumeration<4>(n)
+        && check_enumeration<5>(n) && check_enumeration<6>(n) ? "yes" : "no") << endl;
+
+  // timings: floating-point nr() versus the table, and Key<3> in std::map versus nr() in std::unordered_map
+  const int N=100;
+  long int sum1=0, sum2=0;
+  clock_t start=clock();
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      for (int l=0; l<N; l++)
+        sum1 += (long int)(pow(j+k+l,3)+pow(j+k+l,2)*3+(j+k+l)*2)/6+((j+k)*(j+k+1))/2+j;
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      for (int l=0; l<N; l++)
+        sum2 += Key<3>(j,k,l).nr();
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  std::map<Key<3>,double,Key_Compare<3> > map_Key;
+  std::unordered_map<long int,double> unordered_map_int;
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      for (int l=0; l<N; l++)
+      {
+        map_Key[Key<3>(j,k,l)]=j;
+        unordered_map_int[Key<3>(j,k,l).nr()]=j;
+      }
+  double r1=0, r2=0;
+  start=clock();
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      for (int l=0; l<N; l++)
+        r1 += map_Key.find(Key<3>(j,k,l))->second;
+  const double dur3=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      for (int l=0; l<N; l++)
+        r2 += unordered_map_int.find(Key<3>(j,k,l).nr())->second;
+  const double dur4=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  cout << "- do the sums agree? " << (sum1==sum2 && r1==r2 ? "yes" : "no") << endl;
+
+  cout << "\nnr() for D=3 with pow(): " << dur1 << "s\n";
+  cout << "nr() for D=3 with the binomial table: " << dur2 << "s\n";
+  cout << "\nreading with Key<3> and Key_Compare<3>: " << dur3 << "s\n";
+  cout << "reading with long int and Key<3>::nr() from unordered map: " << dur4 << "s\n";
+
+  // the key streams of access_patterns.h, with N^3/4 keys each
+  benchmark::Harness harness("map_tuple_keys/test_map_NxD", argc, argv, 5);
+  bool agree_streams(true);
+  access_patterns::for_each_pattern<3>(N, N*N*N/4, [&] (const access_patterns::Pattern pattern,
+                                                        const access_patterns::Stream<3>& keys) {
+      const std::string suffix=std::string(" (")+access_patterns::name(pattern)+")";
+      double s1=0, s2=0;
+      cout << endl;
+      harness.run("reading with Key<3> and Key_Compare<3>"+suffix, keys.size(), [&] () {
+          s1=0;
+          for (size_t i=0; i<keys.size(); i++)
+            s1 += map_Key.find(Key<3>(keys[i][0],keys[i][1],keys[i][2]))->second;
+          benchmark::do_not_optimize(s1);
+        });
+      harness.run("reading with long int and Key<3>::nr() from unordered map"+suffix, keys.size(), [&] () {
+          s2=0;
+          for (size_t i=0; i<keys.size(); i++)
+            s2 += unordered_map_int.find(Key<3>(keys[i][0],keys[i][1],keys[i][2]).nr())->second;
+          benchmark::do_not_optimize(s2);
+        });
+      agree_streams = agree_streams && s1==s2;
+    });
+  cout << "\n- do the sums agree for all key streams? " << (agree_streams ? "yes" : "no") << endl;
+
+  return 0;
+}
@@ -1,7 +1,11 @@
 #include<iostream>
 #include<string>
 #include<map>
-#include<time.h>
+#include<unordered_map>
+#include<vector>
+#include<utility>
+#include "benchmark_harness/benchmark_harness.h"
+#include "access_patterns/access_patterns.h"
 using namespace std;
 
 
@@ -21,6 +25,18 @@ yields the bijection
   (1,0) -> 2,
   (0,2) -> 3,
   ...
+Since the comparison object Key_Compare2 has to recompute nr() for both operands
+in every comparison, we also test the class CodedKey, which computes nr() once
+in its constructor and stores it next to the coordinates, so that comparing
+or hashing two keys is a single integer operation.
+Key_Compare is transparent, so that the map with Key_Compare can also be
+read with pairs (j,k), without filling a Key object first (see
+test_map_transparent.cpp for more key representations).
+All experiments run in the benchmark harness (see
+benchmark_harness/benchmark_harness.h), i.e., with warm-up, repetitions
+and median/percentile statistics, and --json=FILE writes the results to FILE.
+The maps are read with all key streams of access_patterns.h (sequential,
+uniform, Zipf-skewed, level-ordered, tree refinement and stencil).
     
 Simon Wardein, January 2020
 Thorsten Raasch, March 2023
@@ -63,13 +79,26 @@ ostream &operator<< (ostream &ostr,const Key& o)
     return ostr;   
     }
 
-// lexicographical comparison of two tuples
+// lexicographical comparison of two tuples, given as Keys or as pairs (j,k);
+// it is transparent, so that find() accepts a pair without building a Key
 struct Key_Compare
 {
+   typedef void is_transparent;
+
    bool operator() (const Key& lhs, const Key& rhs) const
    {
        return((lhs.j < rhs.j) || ((lhs.j == rhs.j) && (lhs.k < rhs.k)));
    }
+
+   bool operator() (const Key& lhs, const pair<int,int>& rhs) const
+   {
+       return((lhs.j < rhs.first) || ((lhs.j == rhs.first) && (lhs.k < rhs.second)));
+   }
+
+   bool operator() (const pair<int,int>& lhs, const Key& rhs) const
+   {
+       return((lhs.first < rhs.j) || ((lhs.first == rhs.j) && (lhs.second < rhs.k)));
+   }
 };
 
 // sorting Keys with nr()
@@ -81,117 +110,211 @@ struct Key_Compare2
    }
 };
 
-int main(){
-// upper bound for N
-int N=500;
-
-map<Key,float,Key_Compare> map_Key; //lexicographical sorting
-map<Key,float,Key_Compare2> map_Key2;//sorting with nr()
-map<long int, float> map_int;       //standard map with long int 
-
-//filling map
-//dur1: Key with Key_compare
-//dur2: Key with Key_compare2
-//dur3: Integer with nr()
+// a tuple (j,k) which stores its number nr(j,k)
+class CodedKey{
+    public:
 
-double dur1, dur2, dur3;
-clock_t start;
-start=clock();
+    CodedKey(int x, int y)
+    : j_(x), k_(y), nr_((long(x)+y)*(long(x)+y+1)/2+x)
+    {}
 
-Key It(0,0);
-for(int j=0;j<N;j++){
-    for(int k=0;k<N;k++)
+    inline
+    int j() const
     {
-        It.j=j;
-        It.k=k;
-        map_Key[It]=1;        
+        return j_;
     }
-}
 
-dur1=( clock() - start ) / (double) CLOCKS_PER_SEC;
-start=clock();
+    inline
+    int k() const
+    {
+        return k_;
+    }
 
-for(int j=0;j<N;j++){
-    for(int k=0;k<N;k++)
+    inline
+    long int nr() const
     {
-        It.j=j;
-        It.k=k;
-        
-        map_Key2[It]=1;        
+        return nr_;
     }
-}
 
-dur2=( clock() - start ) / (double) CLOCKS_PER_SEC;
-start=clock();
+    inline
+    bool operator<(const CodedKey& vgl) const
+    {
+        return nr_ < vgl.nr_;
+    }
 
-for(int j=0;j<N;j++){
-    for(int k=0;k<N;k++){
-        It.j=j;
-        It.k=k;
-        
-        map_int[It.nr()]=1;
+    inline
+    bool operator==(const CodedKey& vgl) const
+    {
+        return nr_ == vgl.nr_;
     }
-}
 
-dur3=( clock() - start ) / (double) CLOCKS_PER_SEC;
+    friend struct CodedKey_Compare;
+    friend struct CodedKey_Hash;
 
-//reading map
+    private:
+    // the coordinates are read-only, so that nr_ stays consistent
+    int j_, k_;
+    long int nr_;
+};
 
-float r=0;
+// sorting CodedKeys with the stored nr()
+struct CodedKey_Compare
+{
+   bool operator() (const CodedKey& lhs, const CodedKey& rhs) const
+   {
+       return lhs.nr_ < rhs.nr_;
+   }
+};
 
-//dur4: Key with Key_compare
-//dur5: Key with Key_compare2
-//dur6: Integer with nr()
+// hashing CodedKeys via the stored nr()
+struct CodedKey_Hash
+{
+   size_t operator() (const CodedKey& key) const
+   {
+       return hash<long int>()(key.nr_);
+   }
+};
 
-double dur4, dur5, dur6;
-//clock_t start;
-start=clock();
 
+int main(int argc, char** argv){
+// upper bound for N
+int N=500;
 
-for(int j=1;j<N;j++){
-    for(int k=1;k<N;k++)
-    {
-          It.j=j;
-        It.k=k;
-        r=map_Key[It];
+map<Key,float,Key_Compare> map_Key; //lexicographical sorting
+map<Key,float,Key_Compare2> map_Key2;//sorting with nr()
+map<long int, float> map_int;       //standard map with long int 
+map<CodedKey,float,CodedKey_Compare> map_CodedKey; //sorting with the stored nr()
+unordered_map<CodedKey,float,CodedKey_Hash> unordered_map_CodedKey; //hashing the stored nr()
+
+//5 repetitions by default, since every map is read with 6 key streams
+benchmark::Harness harness("map_tuple_keys/test_map_NxN", argc, argv, 5);
+
+//filling the empty maps
+cout<<"\nwriting:\n";
+
+harness.run("writing with Key and Key_compare", N*N, [&](){ map_Key.clear(); }, [&](){
+    Key It(0,0);
+    for(int j=0;j<N;j++){
+        for(int k=0;k<N;k++)
+        {
+            It.j=j;
+            It.k=k;
+            map_Key[It]=1;
+        }
     }
-}
-
-  dur4=( clock() - start ) / (double) CLOCKS_PER_SEC;
-  start=clock();
-
-for(int j=1;j<N;j++){
-    for(int k=1;k<N;k++)
-    {
-        It.j=j;
-        It.k=k;
-        r=map_int[It.nr()];
+});
+
+harness.run("writing with Key and Key_compare2", N*N, [&](){ map_Key2.clear(); }, [&](){
+    Key It(0,0);
+    for(int j=0;j<N;j++){
+        for(int k=0;k<N;k++)
+        {
+            It.j=j;
+            It.k=k;
+            map_Key2[It]=1;
+        }
     }
-}
-
-dur5=( clock() - start ) / (double) CLOCKS_PER_SEC;
-start=clock();
+});
+
+harness.run("writing with long int and nr()", N*N, [&](){ map_int.clear(); }, [&](){
+    Key It(0,0);
+    for(int j=0;j<N;j++){
+        for(int k=0;k<N;k++)
+        {
+            It.j=j;
+            It.k=k;
+            map_int[It.nr()]=1;
+        }
+    }
+});
 
+harness.run("writing with CodedKey and CodedKey_Compare", N*N, [&](){ map_CodedKey.clear(); }, [&](){
+    for(int j=0;j<N;j++){
+        for(int k=0;k<N;k++){
+            map_CodedKey[CodedKey(j,k)]=1;
+        }
+    }
+});
 
-for(int j=1;j<N;j++){
-    for(int k=1;k<N;k++)
-    {
-        It.j=j;
-        It.k=k;
-        r=map_Key[It];
+harness.run("writing with CodedKey and CodedKey_Hash into an unordered map", N*N, [&](){ unordered_map_CodedKey.clear(); }, [&](){
+    for(int j=0;j<N;j++){
+        for(int k=0;k<N;k++){
+            unordered_map_CodedKey[CodedKey(j,k)]=1;
+        }
     }
+});
+
+//reading from the filled maps, with the key streams of access_patterns.h
+//(the same seed for all maps), every value is passed to do_not_optimize(),
+//so that the compiler cannot drop the lookups
+for(const access_patterns::Pattern pattern : access_patterns::all_patterns){
+    const vector<access_patterns::Point<2> > keys=access_patterns::generate<2>(pattern,N,(N-1)*(N-1));
+    const string suffix=string(" (")+access_patterns::name(pattern)+")";
+    cout<<"\nreading, "<<access_patterns::name(pattern)<<":\n";
+
+    harness.run("reading with Key and Key_compare"+suffix, keys.size(), [&](){
+        Key It(0,0);
+        float r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            It.j=keys[i][0];
+            It.k=keys[i][1];
+            r=map_Key[It];
+            benchmark::do_not_optimize(r);
+        }
+    });
+
+    harness.run("reading with pairs and the transparent Key_compare"+suffix, keys.size(), [&](){
+        float r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            r=map_Key.find(make_pair(keys[i][0],keys[i][1]))->second;
+            benchmark::do_not_optimize(r);
+        }
+    });
+
+    harness.run("reading with long int and nr()"+suffix, keys.size(), [&](){
+        Key It(0,0);
+        float r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            It.j=keys[i][0];
+            It.k=keys[i][1];
+            r=map_int[It.nr()];
+            benchmark::do_not_optimize(r);
+        }
+    });
+
+    harness.run("reading with Key and Key_compare2"+suffix, keys.size(), [&](){
+        Key It(0,0);
+        float r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            It.j=keys[i][0];
+            It.k=keys[i][1];
+            r=map_Key2[It];
+            benchmark::do_not_optimize(r);
+        }
+    });
+
+    harness.run("reading with CodedKey and CodedKey_Compare"+suffix, keys.size(), [&](){
+        float r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            r=map_CodedKey[CodedKey(keys[i][0],keys[i][1])];
+            benchmark::do_not_optimize(r);
+        }
+    });
+
+    harness.run("reading with CodedKey and CodedKey_Hash from unordered map"+suffix, keys.size(), [&](){
+        float r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            r=unordered_map_CodedKey[CodedKey(keys[i][0],keys[i][1])];
+            benchmark::do_not_optimize(r);
+        }
+    });
 }
-dur6=( clock() - start ) / (double) CLOCKS_PER_SEC;
-
-
-
-cout<<"\nwriting with Key and Key_compare: "<<dur1<<"s\n";
-cout<<"writing with long int and nr():"<< dur2 <<"s\n";
-cout<<"writing with Key and Key_compare2: "<<dur3<<"s\n";
-
-cout<<"\nreading with Key and Key_compare: "<<dur4<<"s\n";
-cout<<"reading with long int and nr():"<< dur5 <<"s\n";
-cout<<"reading with Key and Key_compare2: "<<dur6<<"s\n";
 
 return 0;
 }
@@ -1,9 +1,13 @@
 #include<iostream>
 #include<string>
 #include<map>
+#include<vector>
 #include<unordered_map>
-#include<time.h>
+#include<cstdint>
 #include<math.h>
+#include "benchmark_harness/benchmark_harness.h"
+#include "access_patterns/access_patterns.h"
+#include "map_tuple_keys/hash_mix.h"
 using namespace std;
 
 
@@ -25,6 +29,18 @@ By doing so, we obtain the bijection
    (1,0,0) -> 3,
    (0,0,2) -> 4,
    ...
+Since Key::nr() (and any comparison object based on it) recomputes the number
+on every call, we also test the class CodedKey, which computes nr(j,k,l) once
+(in integer arithmetic) and stores it next to the coordinates, so that both
+comparing and hashing two keys is a single integer operation.
+Finally, std::hash<Key> (see test_map_hash.cpp) lets us put Keys into an
+unordered map directly, instead of their numbers nr(j,k,l).
+All experiments run in the benchmark harness (see
+benchmark_harness/benchmark_harness.h), i.e., with warm-up, repetitions
+and median/percentile statistics, and --json=FILE writes the results to FILE.
+The maps are read with all key streams of access_patterns.h (sequential,
+uniform, Zipf-skewed, level-ordered, tree refinement and stencil), each with
+N^3/4 keys.
      
 Simon Wardein, May 2020
 Thorsten Raasch, March 2023
@@ -53,7 +69,7 @@ class Key{
     }
 
     inline
-    bool operator==(const Key& vgl)
+    bool operator==(const Key& vgl) const
     {
         return (j==vgl.j && k==vgl.k && l==vgl.l);
     }
@@ -68,6 +84,19 @@ class Key{
     
 };
 
+// packing (j,k,l) into 64 bits and mixing them, so that power-of-two tables are safe
+namespace std
+{
+template<>
+struct hash<Key>
+{
+   size_t operator() (const Key& key) const
+   {
+       return hash_mix(hash_pack3(key.j,key.k,key.l));
+   }
+};
+}
+
 ostream &operator<< (ostream &ostr,const Key& a)
     {
     ostr << '(' << a.j << "," << a.k << ","<< a.l <<')';
@@ -85,12 +114,85 @@ struct Key_Compare
 
 
 
-int main(){
+// a triplet (j,k,l) which stores its number nr(j,k,l)
+class CodedKey{
+    public:
+
+    CodedKey(int x, int y, int z)
+    : j_(x), k_(y), l_(z),
+      nr_((long(x)+y+z)*(long(x)+y+z+1)*(long(x)+y+z+2)/6+(long(x)+y)*(long(x)+y+1)/2+x)
+    {}
+
+    inline int j() const { return j_; }
+    inline int k() const { return k_; }
+    inline int l() const { return l_; }
+
+    inline
+    long int nr() const
+    {
+        return nr_;
+    }
+
+    inline
+    bool operator<(const CodedKey& vgl) const
+    {
+        return nr_ < vgl.nr_;
+    }
+
+    inline
+    bool operator==(const CodedKey& vgl) const
+    {
+        return nr_ == vgl.nr_;
+    }
+
+    friend struct CodedKey_Compare;
+    friend struct CodedKey_Hash;
+
+    private:
+    // the coordinates are read-only, so that nr_ stays consistent
+    int j_, k_, l_;
+    long int nr_;
+};
+
+// sorting CodedKeys with the stored nr()
+struct CodedKey_Compare
+{
+   bool operator() (const CodedKey& lhs, const CodedKey& rhs) const
+   {
+       return lhs.nr_ < rhs.nr_;
+   }
+};
+
+// hashing CodedKeys via the stored nr()
+struct CodedKey_Hash
+{
+   size_t operator() (const CodedKey& key) const
+   {
+       return hash<long int>()(key.nr_);
+   }
+};
+
+// sorting Keys with nr(), computed in integer arithmetic
+struct Key_Compare2
+{
+   bool operator() (const Key& lhs, const Key& rhs) const
+   {
+       const long int ls=long(lhs.j)+lhs.k+lhs.l, rs=long(rhs.j)+rhs.k+rhs.l;
+       return ls*(ls+1)*(ls+2)/6+(long(lhs.j)+lhs.k)*(long(lhs.j)+lhs.k+1)/2+lhs.j
+         < rs*(rs+1)*(rs+2)/6+(long(rhs.j)+rhs.k)*(long(rhs.j)+rhs.k+1)/2+rhs.j;
+   }
+};
+
+int main(int argc, char** argv){
 //upper bound for N
 int N=100;
 
 map<Key,double,Key_Compare> map_Key; //lexicographical sorting
+map<Key,double,Key_Compare2> map_Key2; //sorting with nr()
 unordered_map<long int, double> unordered_map_int;
+map<CodedKey,double,CodedKey_Compare> map_CodedKey; //sorting with the stored nr()
+unordered_map<CodedKey,double,CodedKey_Hash> unordered_map_CodedKey;
+unordered_map<Key,double> unordered_map_Key; //hashing with std::hash<Key>
 
 //filling map
 Key It(0,0,0);
@@ -102,85 +204,181 @@ for(int j=0;j<N;j++){
         It.k=k;
         It.l=l;
         map_Key[It]=0; 
+        map_Key2[It]=0;
         unordered_map_int[It.nr()]=0;   
+        map_CodedKey[CodedKey(j,k,l)]=0;
+        unordered_map_CodedKey[CodedKey(j,k,l)]=0;
+        unordered_map_Key[It]=0;
         }
     }
 }
-//dur1: Key with Key_compare
-//dur2: Integer with nr()
-double dur1, dur2;
-clock_t start;
-start=clock();
-
-for(int j=1;j<N;j++){
-    for(int k=1;k<N;k++){
-        for(int l=1;l<N;l++)
-        {
-        It.j=j;
-        It.k=k;
-        It.l=l;
-        map_Key[It]=1; 
+
+//3 repetitions by default, since every experiment touches N^3 entries
+benchmark::Harness harness("map_tuple_keys/test_map_NxNxN", argc, argv, 3);
+
+//writing into the filled maps
+cout<<"\nwriting:\n";
+
+harness.run("writing with Key and Key_compare in a filled map", (N-1)*(N-1)*(N-1), [&](){
+    Key It(0,0,0);
+    for(int j=1;j<N;j++){
+        for(int k=1;k<N;k++){
+            for(int l=1;l<N;l++)
+            {
+            It.j=j;
+            It.k=k;
+            It.l=l;
+            map_Key[It]=1;
+            }
         }
     }
-}
+});
 
-dur1=( clock() - start ) / (double) CLOCKS_PER_SEC;
-start=clock();
+harness.run("writing with long int and nr() in a filled unordered map", N*N*N, [&](){
+    Key It(0,0,0);
+    for(int j=0;j<N;j++){
+        for(int k=0;k<N;k++){
+            for(int l=0;l<N;l++)
+            {
+            It.j=j;
+            It.k=k;
+            It.l=l;
+            unordered_map_int[It.nr()]=1;
+            }
+        }
+    }
+});
 
-for(int j=0;j<N;j++){
-    for(int k=0;k<N;k++){
-        for(int l=0;l<N;l++)
-        {
-        It.j=j;
-        It.k=k;
-        It.l=l;
-        unordered_map_int[It.nr()]=1;       
+harness.run("writing with Key and Key_compare2 in a filled map", (N-1)*(N-1)*(N-1), [&](){
+    Key It(0,0,0);
+    for(int j=1;j<N;j++){
+        for(int k=1;k<N;k++){
+            for(int l=1;l<N;l++)
+            {
+            It.j=j;
+            It.k=k;
+            It.l=l;
+            map_Key2[It]=1;
+            }
         }
     }
-}
+});
 
-dur2=( clock() - start ) / (double) CLOCKS_PER_SEC;
+harness.run("writing with CodedKey and CodedKey_Compare in a filled map", (N-1)*(N-1)*(N-1), [&](){
+    for(int j=1;j<N;j++){
+        for(int k=1;k<N;k++){
+            for(int l=1;l<N;l++)
+            {
+            map_CodedKey[CodedKey(j,k,l)]=1;
+            }
+        }
+    }
+});
 
-//reading map
-//dur3: Key with Key_compare
-//dur4: Integer with nr()
-double dur3, dur4;
-double r=0;
-start=clock();
-for(int j=0;j<N;j++){
-    for(int k=0;k<N;k++){
-        for(int l=0;l<N;l++)
-        {
-        It.j=j;
-        It.k=k;
-        It.l=l;
-        r=map_Key.find(It)->second;
+harness.run("writing with CodedKey and CodedKey_Hash in a filled unordered map", N*N*N, [&](){
+    for(int j=0;j<N;j++){
+        for(int k=0;k<N;k++){
+            for(int l=0;l<N;l++)
+            {
+            unordered_map_CodedKey[CodedKey(j,k,l)]=1;
+            }
         }
     }
-}
+});
 
-dur3=( clock() - start ) / (double) CLOCKS_PER_SEC;
-start=clock();
+harness.run("writing with Key and std::hash<Key> in a filled unordered map", N*N*N, [&](){
+    Key It(0,0,0);
+    for(int j=0;j<N;j++){
+        for(int k=0;k<N;k++){
+            for(int l=0;l<N;l++)
+            {
+            It.j=j;
+            It.k=k;
+            It.l=l;
+            unordered_map_Key[It]=1;
+            }
+        }
+    }
+});
 
-for(int j=0;j<N;j++){
-    for(int k=0;k<N;k++){
-        for(int l=0;l<N;l++)
+//reading from the filled maps, with the key streams of access_patterns.h
+//(the same seed for all maps), every value is passed to do_not_optimize(),
+//so that the compiler cannot drop the lookups
+for(const access_patterns::Pattern pattern : access_patterns::all_patterns){
+    const vector<access_patterns::Point<3> > keys=access_patterns::generate<3>(pattern,N,N*N*N/4);
+    const string suffix=string(" (")+access_patterns::name(pattern)+")";
+    cout<<"\nreading, "<<access_patterns::name(pattern)<<":\n";
+
+    harness.run("reading with Key and Key_compare"+suffix, keys.size(), [&](){
+        Key It(0,0,0);
+        double r=0;
+        for(size_t i=0;i<keys.size();i++)
         {
-        It.j=j;
-        It.k=k;
-        It.l=l;
-        r= unordered_map_int.find(It.nr())->second;
+            It.j=keys[i][0];
+            It.k=keys[i][1];
+            It.l=keys[i][2];
+            r=map_Key.find(It)->second;
+            benchmark::do_not_optimize(r);
         }
-    }
-}
+    });
+
+    harness.run("reading with long int and nr() from unordered map"+suffix, keys.size(), [&](){
+        Key It(0,0,0);
+        double r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            It.j=keys[i][0];
+            It.k=keys[i][1];
+            It.l=keys[i][2];
+            r=unordered_map_int.find(It.nr())->second;
+            benchmark::do_not_optimize(r);
+        }
+    });
 
-dur4=( clock() - start ) / (double) CLOCKS_PER_SEC;
+    harness.run("reading with Key and Key_compare2"+suffix, keys.size(), [&](){
+        Key It(0,0,0);
+        double r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            It.j=keys[i][0];
+            It.k=keys[i][1];
+            It.l=keys[i][2];
+            r=map_Key2.find(It)->second;
+            benchmark::do_not_optimize(r);
+        }
+    });
 
-cout<<"\nwriting with Key and Key_compare in a filled map:  "<<dur1<<"s\n";
-cout<<"writing with long int and nr() in a filled unordered map: "<< dur2 <<"s\n";
+    harness.run("reading with CodedKey and CodedKey_Compare"+suffix, keys.size(), [&](){
+        double r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            r=map_CodedKey.find(CodedKey(keys[i][0],keys[i][1],keys[i][2]))->second;
+            benchmark::do_not_optimize(r);
+        }
+    });
 
-cout<<"\nreading with Key and Key_compare: "<<dur3<<"s\n";
-cout<<"reading with long int and nr() from unordered map: "<< dur4 <<"s\n";
+    harness.run("reading with CodedKey and CodedKey_Hash from unordered map"+suffix, keys.size(), [&](){
+        double r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            r=unordered_map_CodedKey.find(CodedKey(keys[i][0],keys[i][1],keys[i][2]))->second;
+            benchmark::do_not_optimize(r);
+        }
+    });
+
+    harness.run("reading with Key and std::hash<Key> from unordered map"+suffix, keys.size(), [&](){
+        Key It(0,0,0);
+        double r=0;
+        for(size_t i=0;i<keys.size();i++)
+        {
+            It.j=keys[i][0];
+            It.k=keys[i][1];
+            It.l=keys[i][2];
+            r=unordered_map_Key.find(It)->second;
+            benchmark::do_not_optimize(r);
+        }
+    });
+}
 
 return 0;
 }
@@ -0,0 +1,235 @@
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <cassert>
+#include <time.h>
+#include <math.h>
+
+/*
+ In this file, we work out an encoding layer for the Cantor/simplex
+ enumeration of D-tuples (x_0,...,x_{D-1}) of nonnegative integers (see
+ test_map_NxD.cpp),
+   nr(x)=binomial(S_1,1)+binomial(S_2+1,2)+...+binomial(S_D+D-1,D),
+ which stays exact for the index ranges of deep adaptive refinement.
+ The hand-coded Key::nr() from test_map_NxN.cpp overflows in int arithmetic
+ as soon as j+k exceeds 46340, and the 3D version with pow() is no longer
+ exact when (j+k+l)^3 exceeds 2^53.
+ 1) SimplexCode<D,MAXCOORD> is declared with an upper bound MAXCOORD for all
+    coordinates. At compile time, it determines the largest intermediate
+    result of the encoding, and chooses the smallest of uint32_t, uint64_t
+    and unsigned __int128 as its code_type. If even 128 bits do not suffice,
+    the compilation fails.
+ 2) Since the code type is wide enough for all admissible coordinates, the
+    only check needed in debug builds is an assert() on the coordinate bounds,
+    which vanishes with -DNDEBUG.
+ 3) The fast path is the same chain of multiplications, exact divisions and
+    additions as for the hand-coded nr(), e.g., s*(s+1)/2+j in 2D.
+ Codes of type unsigned __int128 can be used as keys of std::map directly;
+ for hashed containers, Code_Hash folds them into a size_t.
+ */
+
+using std::cout;
+using std::endl;
+
+typedef unsigned __int128 uint128_t;
+
+// the smallest unsigned integer type which can hold all values up to bound
+template <uint128_t BOUND>
+using uint_for = std::conditional_t<BOUND <= UINT32_MAX, uint32_t,
+                                    std::conditional_t<BOUND <= UINT64_MAX, uint64_t, uint128_t> >;
+
+// a*b, or 0 if the product does not fit into 128 bits
+constexpr uint128_t checked_multiply(const uint128_t a, const uint128_t b)
+{
+  uint128_t r(0);
+  return __builtin_mul_overflow(a, b, &r) ? 0 : r;
+}
+
+template <unsigned int D, uint64_t MAXCOORD>
+class SimplexCode
+{
+  /*
+   The largest intermediate result of encode(): binomial(n,m) is computed as
+   c=c*(n-i)/(i+1), i=0,...,m-1, and the largest n in the term m is
+   m*MAXCOORD+m-1. Returns 0 on overflow.
+   */
+  static constexpr uint128_t largest_intermediate()
+  {
+    uint128_t largest(0), sum(0);
+    for (unsigned int m = 1; m <= D; m++)
+    {
+      const uint128_t n(uint128_t(m)*MAXCOORD+m-1);
+      uint128_t c(1);
+      for (unsigned int i = 0; i < m; i++)
+      {
+        const uint128_t product(checked_multiply(c, n-i));
+        if (product == 0 && n > i)
+          return 0;
+        largest = std::max(largest, product);
+        c = product/(i+1);
+      }
+      if (sum+c < sum)
+        return 0;
+      sum += c;
+    }
+    return std::max(largest, sum);
+  }
+
+public:
+  static constexpr uint128_t bound = largest_intermediate();
+  static_assert(bound > 0, "the coordinate bounds are too large for 128-bit codes");
+
+  typedef uint_for<bound> code_type;
+
+  static constexpr code_type encode(const std::array<uint64_t,D>& x)
+  {
+    code_type r(0), S(0);
+    for (unsigned int m = 1; m <= D; m++)
+    {
+      assert(x[m-1] <= MAXCOORD);
+      S += x[m-1];
+      // binomial(S+m-1,m), as a chain of multiplications and exact divisions
+      code_type c(1);
+      for (unsigned int i = 0; i < m; i++)
+        c = c*(S+m-1-i)/(i+1);
+      r += c;
+    }
+    return r;
+  }
+};
+
+// 2D and 3D shortcuts with the same loop structure as the hand-coded nr()
+template <uint64_t MAXCOORD>
+constexpr typename SimplexCode<2,MAXCOORD>::code_type nr(const uint64_t j, const uint64_t k)
+{
+  return SimplexCode<2,MAXCOORD>::encode({j, k});
+}
+
+template <uint64_t MAXCOORD>
+constexpr typename SimplexCode<3,MAXCOORD>::code_type nr(const uint64_t j, const uint64_t k, const uint64_t l)
+{
+  return SimplexCode<3,MAXCOORD>::encode({j, k, l});
+}
+
+// hashing codes of all widths
+struct Code_Hash
+{
+  template <class CODE>
+  size_t operator() (const CODE code) const
+  {
+    if constexpr (sizeof(CODE) > sizeof(uint64_t))
+      return std::hash<uint64_t>()(uint64_t(code) ^ (uint64_t(code >> 64) * 0x9E3779B97F4A7C15ull));
+    else
+      return std::hash<uint64_t>()(code);
+  }
+};
+
+std::ostream& operator << (std::ostream& os, uint128_t x)
+{
+  char digits[40];
+  int n(0);
+  do
+  {
+    digits[n++] = '0' + int(x % 10);
+    x /= 10;
+  } while (x > 0);
+  while (n > 0)
+    os << digits[--n];
+  return os;
+}
+
+static_assert(std::is_same_v<SimplexCode<2,30000>::code_type, uint32_t>);
+static_assert(std::is_same_v<SimplexCode<2,(1ull<<30)>::code_type, uint64_t>);
+static_assert(std::is_same_v<SimplexCode<2,(1ull<<62)>::code_type, uint128_t>);
+static_assert(std::is_same_v<SimplexCode<3,(1ull<<20)>::code_type, uint64_t>);
+static_assert(std::is_same_v<SimplexCode<6,(1ull<<16)>::code_type, uint128_t>);
+static_assert(nr<100>(1,0) == 2 && nr<100>(0,0,1) == 1 && nr<100>(1,0,0) == 3);
+
+// the hand-coded enumerations from test_map_NxN.cpp and test_map_NxNxN.cpp
+long int nr_int(int j, int k)
+{
+  return (j+k)*(j+k+1)/2+j;
+}
+
+long int nr_pow(int j, int k, int l)
+{
+  return (pow(j+k+l,3)+pow(j+k+l,2)*3+(j+k+l)*2)/6+((j+k)*(j+k+1))/2+j;
+}
+
+template <unsigned int D, uint64_t MAXCOORD>
+void print_code_type(const char* name)
+{
+  cout << "  " << name << ": " << 8*sizeof(typename SimplexCode<D,MAXCOORD>::code_type) << " bits" << endl;
+}
+
+template <uint64_t MAXCOORD>
+void benchmark_encode(const char* name, const uint64_t offset, const int N)
+{
+  // the checksum is taken modulo 2^64 for every code type, so that the results are comparable
+  uint64_t sum(0);
+  clock_t start=clock();
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      sum += uint64_t(nr<MAXCOORD>(offset+j, offset+k));
+  const double dur=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << name << ": " << dur << "s (checksum " << sum << ")\n";
+}
+
+int main()
+{
+  cout << "- the code types for the declared bounds:" << endl;
+  print_code_type<2,30000>("D=2, coordinates up to 30000");
+  print_code_type<2,(1ull<<30)>("D=2, coordinates up to 2^30");
+  print_code_type<2,(1ull<<62)>("D=2, coordinates up to 2^62");
+  print_code_type<3,1000>("D=3, coordinates up to 1000");
+  print_code_type<3,(1ull<<20)>("D=3, coordinates up to 2^20");
+  print_code_type<3,(1ull<<40)>("D=3, coordinates up to 2^40");
+  print_code_type<6,(1ull<<16)>("D=6, coordinates up to 2^16");
+
+  // where the hand-coded versions fail
+  const int j=40000, k=30000;
+  cout << "- nr(" << j << "," << k << "): in int arithmetic " << nr_int(j, k)
+    << ", with SimplexCode " << nr<(1ull<<30)>(j, k) << endl;
+  const int l=300000;
+  cout << "- nr(" << l << "," << l+1 << "," << l+2 << "): with pow() " << nr_pow(l, l+1, l+2)
+    << ", with SimplexCode " << nr<(1ull<<20)>(l, l+1, l+2) << endl;
+  const uint64_t deep=(1ull<<50)+12345;
+  cout << "- nr(2^50+12345,2^50+12345) with SimplexCode: " << nr<(1ull<<62)>(deep, deep) << endl;
+
+  // check the codes against the hand-coded versions where these are still exact
+  bool ok(true);
+  for (int j=0; j<200; j++)
+    for (int k=0; k<200; k++)
+    {
+      ok = ok && nr<30000>(j, k) == uint64_t(nr_int(j, k))
+        && nr<(1ull<<62)>(j, k) == uint64_t(nr_int(j, k));
+      for (int l=0; l<50; l++)
+        ok = ok && nr<1000>(j, k, l) == uint64_t(nr_pow(j, k, l))
+          && nr<(1ull<<40)>(j, k, l) == uint64_t(nr_pow(j, k, l));
+    }
+  cout << "- do the codes agree with the hand-coded nr() for small keys? " << (ok ? "yes" : "no") << endl;
+
+  // 128-bit codes as keys of std::map and std::unordered_map
+  std::map<uint128_t,double> map_code;
+  std::unordered_map<uint128_t,double,Code_Hash> unordered_map_code;
+  for (uint64_t i=0; i<100; i++)
+    for (uint64_t k=0; k<100; k++)
+    {
+      map_code[nr<(1ull<<62)>(deep+i, deep+k)] = i;
+      unordered_map_code[nr<(1ull<<62)>(deep+i, deep+k)] = i;
+    }
+  cout << "- are the 128-bit codes of a 100x100 block distinct? "
+    << (map_code.size() == 10000 && unordered_map_code.size() == 10000 ? "yes" : "no") << endl;
+
+  // timings of the code widths
+  const int N=3000;
+  cout << endl;
+  benchmark_encode<30000>("encoding with 32-bit codes", 0, N);
+  benchmark_encode<(1ull<<30)>("encoding with 64-bit codes", 0, N);
+  benchmark_encode<(1ull<<62)>("encoding with 128-bit codes", 0, N);
+
+  return 0;
+}
@@ -0,0 +1,288 @@
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <cstdint>
+#include <time.h>
+#include <math.h>
+#include "map_tuple_keys/hash_mix.h"
+#include "benchmark_harness/benchmark_harness.h"
+#include "access_patterns/access_patterns.h"
+
+/*
+ In this file, we provide specializations of std::hash for the tuple keys
+ (j,k) (level and translation) and (j,k,l), so that they can be used in
+ std::unordered_map without falling back to integer codes.
+ The usual ad hoc hashes like (j<<32)+k or nr(j,k) are passed through
+ std::hash<long>, which is the identity in libstdc++. Structured inputs then
+ produce hash values whose lower bits follow the regular patterns of the
+ translations, which is harmless for the prime bucket counts of libstdc++,
+ but fatal for hash tables with power-of-two sizes, which just take the
+ lower bits. We therefore pack the coordinates into 64 bits and apply the
+ mixing function hash_mix() from hash_mix.h, after which every input bit
+ affects all output bits.
+ The batch variants hash_batch() compute the hashes of a whole array of Key
+ or Key3 in a loop without branches and calls, which the compiler can vectorize
+ (64-bit multiplications need AVX-512DQ for a single instruction, but are
+ emulated on AVX2). We compare it with hashing one key per call of a
+ function which must not be inlined, so that the loop cannot be vectorized.
+ The timings are only meaningful with vectorization enabled, i.e., when
+ compiling with -O3 -march=native.
+ We count the collisions in power-of-two tables for typical refinement
+ patterns, compared with the expected number for a random hash function.
+ Finally, std::unordered_map is timed with the keys of an adaptive
+ refinement, and with the key streams of access_patterns.h on a full grid,
+ the latter in the benchmark harness (see benchmark_harness/benchmark_harness.h).
+ */
+
+using std::cout;
+using std::endl;
+
+class Key
+{
+public:
+  int j, k;
+
+  Key(int x, int y)
+  : j(x), k(y)
+  {
+  }
+
+  long int nr() const
+  {
+    return (long(j)+k)*(long(j)+k+1)/2+j;
+  }
+
+  bool operator == (const Key& vgl) const
+  {
+    return (j == vgl.j && k == vgl.k);
+  }
+};
+
+class Key3
+{
+public:
+  int j, k, l;
+
+  Key3(int x, int y, int z)
+  : j(x), k(y), l(z)
+  {
+  }
+
+  bool operator == (const Key3& vgl) const
+  {
+    return (j == vgl.j && k == vgl.k && l == vgl.l);
+  }
+};
+
+namespace std
+{
+  template <>
+  struct hash<Key>
+  {
+    size_t operator() (const Key& key) const
+    {
+      return hash_mix(hash_pack2(key.j, key.k));
+    }
+  };
+
+  template <>
+  struct hash<Key3>
+  {
+    size_t operator() (const Key3& key) const
+    {
+      // j and k in the upper and the lower word, l spread over all 64 bits
+      return hash_mix(hash_pack3(key.j, key.k, key.l));
+    }
+  };
+}
+
+// the hashes of all keys, in one loop
+void hash_batch(std::span<const Key> keys, std::span<size_t> hashes)
+{
+  for (size_t i = 0; i < keys.size(); i++)
+    hashes[i] = hash_mix(hash_pack2(keys[i].j, keys[i].k));
+}
+
+void hash_batch(std::span<const Key3> keys, std::span<size_t> hashes)
+{
+  for (size_t i = 0; i < keys.size(); i++)
+    hashes[i] = hash_mix(hash_pack3(keys[i].j, keys[i].k, keys[i].l));
+}
+
+// the hash of a single key, which the compiler may neither inline nor vectorize
+__attribute__((noinline)) size_t hash_one(const Key& key)
+{
+  return std::hash<Key>()(key);
+}
+
+// the ad hoc hashes, for comparison
+struct Key_Hash_Shift
+{
+  size_t operator() (const Key& key) const
+  {
+    return std::hash<long>()((long(key.j) << 32) + key.k);
+  }
+};
+
+struct Key_Hash_nr
+{
+  size_t operator() (const Key& key) const
+  {
+    return std::hash<long>()(key.nr());
+  }
+};
+
+struct Key3_Hash_Shift
+{
+  size_t operator() (const Key3& key) const
+  {
+    return std::hash<long>()((long(key.j) << 40) + (long(key.k) << 20) + key.l);
+  }
+};
+
+/*
+ Count the collisions of the keys in a table with 2^m buckets, the smallest
+ power of two which is not less than the number of keys, and compare them
+ with the expected number for a random hash function.
+ */
+template <class KEY, class HASH>
+void count_collisions(const char* name, const std::vector<KEY>& keys)
+{
+  size_t buckets(1);
+  while (buckets < keys.size())
+    buckets *= 2;
+  std::vector<unsigned int> load(buckets, 0);
+  HASH hasher;
+  for (size_t i = 0; i < keys.size(); i++)
+    load[hasher(keys[i]) & (buckets-1)]++;
+  const size_t occupied(std::count_if(load.begin(), load.end(), [] (const unsigned int l) { return l > 0; }));
+  const double n(keys.size()), b(buckets);
+  const double expected(n - b*(1-pow(1-1/b, n)));
+  cout << "  " << name << ": " << keys.size()-occupied << " collisions (random: " << size_t(expected)
+    << "), maximal load " << *std::max_element(load.begin(), load.end()) << endl;
+}
+
+template <class MAP>
+void benchmark_map(const char* name, const std::vector<Key>& keys)
+{
+  MAP map;
+  clock_t start=clock();
+  for (size_t i=0; i<keys.size(); i++)
+    map[keys[i]] = i;
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  double r=0;
+  start=clock();
+  for (int rep=0; rep<5; rep++)
+    for (size_t i=0; i<keys.size(); i++)
+      r += map.find(keys[i])->second;
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << name << ": writing " << dur1 << "s, reading " << dur2 << "s (checksum " << r << ")\n";
+}
+
+// the full grid {0,...,N-1}^2
+template <class MAP>
+MAP full_grid(const int N)
+{
+  MAP map;
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      map[Key(j,k)] = j;
+  return map;
+}
+
+// read all keys of the stream from the map
+template <class MAP>
+void benchmark_stream(benchmark::Harness& harness, const std::string& name, const MAP& map,
+                      const access_patterns::Stream<2>& keys)
+{
+  harness.run(name, keys.size(), [&] () {
+      double r=0;
+      for (size_t i=0; i<keys.size(); i++)
+        r += map.find(Key(keys[i][0], keys[i][1]))->second;
+      benchmark::do_not_optimize(r);
+    });
+}
+
+int main(int argc, char** argv)
+{
+  // all wavelets up to level 16
+  std::vector<Key> full;
+  for (int j=0; j<=16; j++)
+    for (int k=0; k<(1<<j); k++)
+      full.push_back(Key(j,k));
+
+  // adaptive refinement towards a point singularity at x=1/3, up to level 30
+  std::vector<Key> adaptive;
+  for (int j=0; j<=30; j++)
+  {
+    const int center((1<<j)/3);
+    for (int k=std::max(0, center-2000); k<std::min(1<<j, center+2000); k++)
+      adaptive.push_back(Key(j,k));
+  }
+
+  // tensor products of wavelets in 2D, up to level 8
+  std::vector<Key3> tensor;
+  for (int j=0; j<=8; j++)
+    for (int k=0; k<(1<<j); k++)
+      for (int l=0; l<(1<<j); l++)
+        tensor.push_back(Key3(j,k,l));
+
+  cout << "- collisions in power-of-two tables:" << endl;
+  cout << " " << full.size() << " keys on the full levels 0,...,16:" << endl;
+  count_collisions<Key,std::hash<Key> >("std::hash<Key>", full);
+  count_collisions<Key,Key_Hash_Shift>("(j<<32)+k", full);
+  count_collisions<Key,Key_Hash_nr>("nr(j,k)", full);
+  cout << " " << adaptive.size() << " keys of an adaptive refinement:" << endl;
+  count_collisions<Key,std::hash<Key> >("std::hash<Key>", adaptive);
+  count_collisions<Key,Key_Hash_Shift>("(j<<32)+k", adaptive);
+  count_collisions<Key,Key_Hash_nr>("nr(j,k)", adaptive);
+  cout << " " << tensor.size() << " keys of 2D tensor product wavelets:" << endl;
+  count_collisions<Key3,std::hash<Key3> >("std::hash<Key3>", tensor);
+  count_collisions<Key3,Key3_Hash_Shift>("(j<<40)+(k<<20)+l", tensor);
+
+  // scalar versus batched hashing
+  std::vector<size_t> h1(adaptive.size()), h2(adaptive.size());
+  const int repetitions=20;
+  clock_t start=clock();
+  for (int r=0; r<repetitions; r++)
+    for (size_t i=0; i<adaptive.size(); i++)
+      h1[i] = hash_one(adaptive[i]);
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    hash_batch(adaptive, h2);
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << "- do the batched hashes agree? " << (h1 == h2 ? "yes" : "no") << endl;
+  std::vector<size_t> h3(tensor.size()), h4(tensor.size());
+  for (size_t i=0; i<tensor.size(); i++)
+    h3[i] = std::hash<Key3>()(tensor[i]);
+  hash_batch(tensor, h4);
+  cout << "- do the batched hashes of Key3 agree? " << (h3 == h4 ? "yes" : "no") << endl;
+
+  cout << "\nhashing one key per call: " << dur1 << "s\n";
+  cout << "hash_batch(): " << dur2 << "s (only meaningful with -O3 -march=native)\n\n";
+
+  benchmark_map<std::unordered_map<Key,double> >("std::unordered_map with std::hash<Key>", adaptive);
+  benchmark_map<std::unordered_map<Key,double,Key_Hash_Shift> >("std::unordered_map with (j<<32)+k", adaptive);
+  benchmark_map<std::unordered_map<Key,double,Key_Hash_nr> >("std::unordered_map with nr(j,k)", adaptive);
+
+  const int N=500;
+  const std::unordered_map<Key,double> map_hash(full_grid<std::unordered_map<Key,double> >(N));
+  const std::unordered_map<Key,double,Key_Hash_Shift> map_shift(full_grid<std::unordered_map<Key,double,Key_Hash_Shift> >(N));
+  const std::unordered_map<Key,double,Key_Hash_nr> map_nr(full_grid<std::unordered_map<Key,double,Key_Hash_nr> >(N));
+  benchmark::Harness harness("map_tuple_keys/test_map_hash", argc, argv, 5);
+  access_patterns::for_each_pattern<2>(N, N*N, [&] (const access_patterns::Pattern pattern,
+                                                    const access_patterns::Stream<2>& keys) {
+      const std::string suffix=std::string(" (")+access_patterns::name(pattern)+")";
+      cout << "\nreading a full " << N << "x" << N << " grid, " << access_patterns::name(pattern) << ":\n";
+      benchmark_stream(harness, "std::unordered_map with std::hash<Key>"+suffix, map_hash, keys);
+      benchmark_stream(harness, "std::unordered_map with (j<<32)+k"+suffix, map_shift, keys);
+      benchmark_stream(harness, "std::unordered_map with nr(j,k)"+suffix, map_nr, keys);
+    });
+
+  return 0;
+}
@@ -0,0 +1,455 @@
+#include <iostream>
+#include <map>
+#include <vector>
+#include <array>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <bit>
+#include <time.h>
+#include "benchmark_harness/benchmark_harness.h"
+#include "access_patterns/access_patterns.h"
+
+/*
+ In this file, we test the ordering of the tuple keys (j,k) and (j,k,l) along
+ the Hilbert curve. Like the Z-order curve from test_map_morton.cpp, the
+ Hilbert curve runs through the grid block by block, but consecutive keys
+ are always neighbours in the grid, so that it should preserve locality even
+ better than both the Morton code and Cantor's enumeration nr().
+ For general dimensions D, the Hilbert index is computed with Skilling's
+ transform (J. Skilling, Programming the Hilbert curve, AIP Conf. Proc. 707,
+ 2004): the coordinates are transformed in place into the "transposed"
+ Hilbert index, whose bits are then interleaved like a Morton code. This costs
+ O(B*D) bit operations for B bits per coordinate, which is too expensive for
+ a comparison object. In 2D, we therefore run the curve as a state machine
+ with four states (the orientations of the current subsquare), processing
+ four levels per lookup in a table which is computed at compile time.
+ Since four levels with zero bits lead back to the initial state, leading
+ zero levels are skipped, so that small keys need only one or two lookups.
+ The codes are used by the comparison object Key_Compare_Hilbert, which can
+ be selected via the CONTAINER parameter of InfiniteVector, e.g.,
+   InfiniteVector<double,Key,std::map<Key,double,Key_Compare_Hilbert> >.
+ In order to compare the locality of the orderings, we apply the 5-point
+ stencil to a grid function which is stored in a flat array, sorted by the
+ respective ordering, and count the misses of a simulated direct-mapped
+ 32KB L1 data cache on the accesses to the entries. Wall clock timings of the
+ same stencil are given for std::map with the different comparisons, and
+ for reading the maps with the key streams of access_patterns.h in the
+ benchmark harness (see benchmark_harness/benchmark_harness.h).
+ */
+
+using std::cout;
+using std::endl;
+
+class Key
+{
+public:
+  int j, k;
+
+  Key(int x, int y)
+  : j(x), k(y)
+  {
+  }
+
+  long int nr() const
+  {
+    return (long(j)+k)*(long(j)+k+1)/2+j;
+  }
+
+  bool operator == (const Key& vgl) const
+  {
+    return (j == vgl.j && k == vgl.k);
+  }
+};
+
+/*
+ The Hilbert index of the D coordinates x with B bits each, where x[0]
+ corresponds to the most significant bit of each group of D bits.
+ */
+template <unsigned int D, unsigned int B>
+uint64_t hilbert_encode(std::array<uint32_t,D> x)
+{
+  static_assert(D*B <= 64, "the Hilbert index does not fit into 64 bits");
+  const uint32_t M(uint32_t(1) << (B-1));
+
+  // inverse undo
+  for (uint32_t Q = M; Q > 1; Q >>= 1)
+  {
+    const uint32_t P(Q-1);
+    for (unsigned int i = 0; i < D; i++)
+      if (x[i] & Q)
+        x[0] ^= P; // invert
+      else
+      {
+        const uint32_t t((x[0] ^ x[i]) & P); // exchange
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+  }
+
+  // Gray encode
+  for (unsigned int i = 1; i < D; i++)
+    x[i] ^= x[i-1];
+  uint32_t t(0);
+  for (uint32_t Q = M; Q > 1; Q >>= 1)
+    if (x[D-1] & Q)
+      t ^= Q-1;
+  for (unsigned int i = 0; i < D; i++)
+    x[i] ^= t;
+
+  // interleave the transposed index
+  uint64_t code(0);
+  for (int b = B-1; b >= 0; b--)
+    for (unsigned int i = 0; i < D; i++)
+      code = (code << 1) | ((x[i] >> b) & 1);
+  return code;
+}
+
+// the inverse of hilbert_encode()
+template <unsigned int D, unsigned int B>
+std::array<uint32_t,D> hilbert_decode(const uint64_t code)
+{
+  std::array<uint32_t,D> x;
+  x.fill(0);
+  for (int b = B-1; b >= 0; b--)
+    for (unsigned int i = 0; i < D; i++)
+      x[i] |= uint32_t((code >> (b*D + D-1-i)) & 1) << b;
+
+  // Gray decode
+  uint32_t t(x[D-1] >> 1);
+  for (unsigned int i = D-1; i > 0; i--)
+    x[i] ^= x[i-1];
+  x[0] ^= t;
+
+  // undo excess work
+  for (uint32_t Q = 2; Q != (uint32_t(2) << (B-1)); Q <<= 1)
+  {
+    const uint32_t P(Q-1);
+    for (int i = D-1; i >= 0; i--)
+      if (x[i] & Q)
+        x[0] ^= P;
+      else
+      {
+        t = (x[0] ^ x[i]) & P;
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+  }
+  return x;
+}
+
+/*
+ The 2D Hilbert curve as a state machine. A state (swap,invert) is the
+ orientation of the current subsquare. The tables map a state and four bits
+ of each coordinate to the next eight bits of the code and the new state
+ (encode), and vice versa (decode).
+ */
+struct HilbertTable2D
+{
+  uint16_t encode[4][256]; // (state, 4 bits of j, 4 bits of k) -> (8 bits of the code, state)
+  uint16_t decode[4][256]; // (state, 8 bits of the code) -> (4 bits of j, 4 bits of k, state)
+
+  constexpr HilbertTable2D()
+  : encode(), decode()
+  {
+    for (unsigned int s = 0; s < 4; s++)
+      for (unsigned int bits = 0; bits < 256; bits++)
+      {
+        unsigned int state(s), code(0);
+        for (int b = 3; b >= 0; b--)
+        {
+          unsigned int x(((bits >> 4) >> b) & 1), y((bits >> b) & 1);
+          if (state & 2)
+          {
+            x ^= 1;
+            y ^= 1;
+          }
+          if (state & 1)
+            std::swap(x, y);
+          code = (code << 2) | ((3*x) ^ y);
+          if (y == 0)
+          {
+            if (x == 1)
+              state ^= 2;
+            state ^= 1;
+          }
+        }
+        encode[s][bits] = (code << 2) | state;
+        decode[s][code] = (bits << 2) | state;
+      }
+  }
+};
+
+constexpr HilbertTable2D hilbert_table;
+
+// Hilbert codes of the keys, with 32 bits per coordinate
+inline uint64_t hilbert(const Key& key)
+{
+  const uint32_t j(key.j), k(key.k);
+  uint64_t code(0);
+  unsigned int state(0);
+  for (int c = (35 - std::countl_zero(j | k)) / 4 - 1; c >= 0; c--)
+  {
+    const uint16_t e(hilbert_table.encode[state][(((j >> 4*c) & 15) << 4) | ((k >> 4*c) & 15)]);
+    code = (code << 8) | (e >> 2);
+    state = e & 3;
+  }
+  return code;
+}
+
+inline Key hilbert_to_key(const uint64_t code)
+{
+  uint32_t j(0), k(0);
+  unsigned int state(0);
+  for (int c = (71 - std::countl_zero(code)) / 8 - 1; c >= 0; c--)
+  {
+    const uint16_t e(hilbert_table.decode[state][(code >> 8*c) & 255]);
+    j = (j << 4) | (e >> 6);
+    k = (k << 4) | ((e >> 2) & 15);
+    state = e & 3;
+  }
+  return Key(j, k);
+}
+
+// Morton codes of the keys, see test_map_morton.cpp
+inline uint64_t spread_bits_2(uint64_t x)
+{
+  x &= 0x00000000FFFFFFFFull;
+  x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+  x = (x | (x << 8))  & 0x00FF00FF00FF00FFull;
+  x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | (x << 2))  & 0x3333333333333333ull;
+  x = (x | (x << 1))  & 0x5555555555555555ull;
+  return x;
+}
+
+inline uint64_t morton(const Key& key)
+{
+  return (spread_bits_2(key.j) << 1) | spread_bits_2(key.k);
+}
+
+// lexicographical comparison of two tuples
+struct Key_Compare
+{
+  bool operator() (const Key& lhs, const Key& rhs) const
+  {
+    return ((lhs.j < rhs.j) || ((lhs.j == rhs.j) && (lhs.k < rhs.k)));
+  }
+};
+
+// sorting Keys with nr()
+struct Key_Compare2
+{
+  bool operator() (const Key& lhs, const Key& rhs) const
+  {
+    return (lhs.nr() < rhs.nr());
+  }
+};
+
+// sorting Keys along the Z-order curve
+struct Key_Compare_Morton
+{
+  bool operator() (const Key& lhs, const Key& rhs) const
+  {
+    return (morton(lhs) < morton(rhs));
+  }
+};
+
+// sorting Keys along the Hilbert curve
+struct Key_Compare_Hilbert
+{
+  bool operator() (const Key& lhs, const Key& rhs) const
+  {
+    return (hilbert(lhs) < hilbert(rhs));
+  }
+};
+
+// a direct-mapped cache, which counts the misses on a sequence of accesses
+class CacheSimulator
+{
+public:
+  CacheSimulator(const size_t size = 32768, const size_t line = 64)
+  : _line(line), _tags(size/line, size_t(-1)), _accesses(0), _misses(0)
+  {
+  }
+
+  void access(const void* address)
+  {
+    const size_t tag(reinterpret_cast<size_t>(address) / _line);
+    size_t& slot(_tags[tag % _tags.size()]);
+    _accesses++;
+    if (slot != tag)
+    {
+      slot = tag;
+      _misses++;
+    }
+  }
+
+  size_t accesses() const
+  {
+    return _accesses;
+  }
+
+  size_t misses() const
+  {
+    return _misses;
+  }
+
+private:
+  size_t _line;
+  std::vector<size_t> _tags;
+  size_t _accesses, _misses;
+};
+
+/*
+ Apply the 5-point stencil to an NxN grid function, which is stored as a flat
+ array sorted by code(key). The positions of the neighbours are precomputed,
+ so that only the accesses to the entries themselves are counted.
+ */
+template <class CODE>
+void simulate_stencil(const char* name, const int N, CODE code)
+{
+  std::vector<uint64_t> codes(N*N);
+  std::vector<size_t> order(N*N);
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+    {
+      codes[j*N+k] = code(Key(j,k));
+      order[j*N+k] = j*N+k;
+    }
+  std::sort(order.begin(), order.end(), [&codes] (const size_t a, const size_t b) { return codes[a] < codes[b]; });
+
+  std::vector<size_t> position(N*N);
+  for (size_t p=0; p<order.size(); p++)
+    position[order[p]] = p;
+
+  std::vector<double> x(order.size());
+  for (size_t p=0; p<order.size(); p++)
+    x[p] = ((order[p]/N)*(order[p]%N))%7;
+
+  CacheSimulator cache;
+  double r(0);
+  double distance(0);
+  for (size_t p=0; p<order.size(); p++)
+  {
+    const int j(order[p]/N), k(order[p]%N);
+    cache.access(&x[p]);
+    double y(4*x[p]);
+    const int neighbours[4][2] = {{j-1,k}, {j+1,k}, {j,k-1}, {j,k+1}};
+    for (int n=0; n<4; n++)
+      if (neighbours[n][0] >= 0 && neighbours[n][0] < N && neighbours[n][1] >= 0 && neighbours[n][1] < N)
+      {
+        const size_t q(position[neighbours[n][0]*N+neighbours[n][1]]);
+        cache.access(&x[q]);
+        y -= x[q];
+        distance += (q > p ? q-p : p-q);
+      }
+    r += y*y;
+  }
+  cout << name << ": " << cache.misses() << " misses in " << cache.accesses() << " accesses ("
+    << 100.0*cache.misses()/cache.accesses() << "%), mean distance of the neighbours "
+    << distance/(4.0*order.size()) << ", result " << r << "\n";
+}
+
+template <class MAP>
+double apply_stencil(const MAP& x)
+{
+  double r(0);
+  for (typename MAP::const_iterator it(x.begin()); it != x.end(); ++it)
+  {
+    const Key& key(it->first);
+    double y(4*it->second);
+    typename MAP::const_iterator n;
+    if ((n = x.find(Key(key.j-1, key.k))) != x.end()) y -= n->second;
+    if ((n = x.find(Key(key.j+1, key.k))) != x.end()) y -= n->second;
+    if ((n = x.find(Key(key.j, key.k-1))) != x.end()) y -= n->second;
+    if ((n = x.find(Key(key.j, key.k+1))) != x.end()) y -= n->second;
+    r += y*y;
+  }
+  return r;
+}
+
+template <class MAP>
+void benchmark_stencil(benchmark::Harness& harness, const std::string& name, const int N)
+{
+  MAP x;
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      x[Key(j,k)]=(j*k)%7;
+  clock_t start=clock();
+  const double r=apply_stencil(x);
+  const double dur=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << name << ": " << dur << "s, result " << r << "\n";
+  access_patterns::for_each_pattern<2>(N, N*N, [&] (const access_patterns::Pattern pattern,
+                                                    const access_patterns::Stream<2>& keys) {
+      harness.run(name+", reading ("+access_patterns::name(pattern)+")", keys.size(), [&] () {
+          double sum(0);
+          for (size_t i=0; i<keys.size(); i++)
+            sum += x.find(Key(keys[i][0], keys[i][1]))->second;
+          benchmark::do_not_optimize(sum);
+        });
+    });
+}
+
+int main(int argc, char** argv)
+{
+  cout << "- the Hilbert curve on the first 4x4 keys:";
+  for (uint64_t code=0; code<16; code++)
+  {
+    const Key key(hilbert_to_key(code));
+    cout << " (" << key.j << "," << key.k << ")";
+  }
+  cout << endl;
+
+  // consecutive codes have to be neighbours, and decoding has to invert encoding
+  bool ok(true);
+  for (uint64_t code=0; code<(1<<20); code++)
+  {
+    const Key key(hilbert_to_key(code));
+    ok = ok && hilbert(key) == code;
+    if (code > 0)
+    {
+      const Key previous(hilbert_to_key(code-1));
+      ok = ok && abs(key.j-previous.j)+abs(key.k-previous.k) == 1;
+    }
+  }
+  ok = ok && hilbert_to_key(hilbert(Key(0x7FFFFFFF,12345))) == Key(0x7FFFFFFF,12345);
+  for (uint64_t code=0; code<(1<<15); code++)
+    {
+      const std::array<uint32_t,2> x(hilbert_decode<2,16>(code));
+      ok = ok && hilbert_encode<2,16>(x) == code;
+    }
+  for (uint64_t code=0; code<(1<<15); code++)
+  {
+    const std::array<uint32_t,3> x(hilbert_decode<3,21>(code));
+    ok = ok && hilbert_encode<3,21>(x) == code;
+    if (code > 0)
+    {
+      const std::array<uint32_t,3> y(hilbert_decode<3,21>(code-1));
+      ok = ok && abs(int(x[0]-y[0]))+abs(int(x[1]-y[1]))+abs(int(x[2]-y[2])) == 1;
+    }
+  }
+  cout << "- are consecutive keys neighbours, in 2D and 3D? " << (ok ? "yes" : "no") << endl;
+
+  // with a 32KB cache, three rows of the grid do not fit into the cache for N>=2048
+  cout << "\nsimulated 32KB L1 cache, 5-point stencil on NxN grids in a flat array:\n";
+  for (int N=512; N<=2048; N*=4)
+  {
+    cout << "N=" << N << ":\n";
+    simulate_stencil("Key_Compare", N, [] (const Key& key) { return (uint64_t(key.j) << 32) | key.k; });
+    simulate_stencil("Key_Compare2", N, [] (const Key& key) { return uint64_t(key.nr()); });
+    simulate_stencil("Key_Compare_Morton", N, [] (const Key& key) { return morton(key); });
+    simulate_stencil("Key_Compare_Hilbert", N, [] (const Key& key) { return hilbert(key); });
+  }
+
+  const int N=512;
+  benchmark::Harness harness("map_tuple_keys/test_map_hilbert", argc, argv, 5);
+  cout << "\n5-point stencil and reading with all key streams, with std::map:\n";
+  benchmark_stencil<std::map<Key,double,Key_Compare> >(harness, "Key_Compare", N);
+  benchmark_stencil<std::map<Key,double,Key_Compare2> >(harness, "Key_Compare2", N);
+  benchmark_stencil<std::map<Key,double,Key_Compare_Morton> >(harness, "Key_Compare_Morton", N);
+  benchmark_stencil<std::map<Key,double,Key_Compare_Hilbert> >(harness, "Key_Compare_Hilbert", N);
+
+  return 0;
+}
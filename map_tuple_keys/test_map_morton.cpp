@@ -0,0 +1,365 @@
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cassert>
+#include <time.h>
+#include "benchmark_harness/benchmark_harness.h"
+#include "access_patterns/access_patterns.h"
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+/*
+ In this file, we test an alternative ordering of the tuple keys (j,k) and
+ (j,k,l) by the Morton code (Z-order curve), which interleaves the bits of
+ the coordinates, e.g., for (j,k)
+   morton(j,k)=...j_1 k_1 j_0 k_0 (in binary).
+ In contrast to Cantor's diagonal enumeration nr() from test_map_NxN.cpp,
+ which places the neighbours (j,k+1) and (j+1,k) about j+k positions away
+ from (j,k), the Z-order curve keeps most spatial neighbours close to each
+ other in the key space, which should help stencil-like operator applications.
+ On CPUs with BMI2 (compile with -mbmi2 or -march=native, which the CMake
+ build does if the build machine supports it), the bits are interleaved with
+ a single pdep instruction per coordinate (and extracted with pext);
+ otherwise, we fall back to the usual shift-and-mask sequences.
+ The codes are used by the comparison object Key_Compare_Morton and by the
+ hash function Key_Hash_Morton, so that they can be selected via the
+ CONTAINER parameter of InfiniteVector, e.g.,
+   InfiniteVector<double,Key,std::map<Key,double,Key_Compare_Morton> >.
+ We support 32 bits per coordinate in 2D and 21 bits per coordinate in 3D,
+ the latter being asserted.
+ Besides the stencil, every map is read with the key streams of
+ access_patterns.h, in the benchmark harness (see
+ benchmark_harness/benchmark_harness.h).
+ */
+
+using std::cout;
+using std::endl;
+
+class Key
+{
+public:
+  int j, k;
+
+  Key(int x, int y)
+  : j(x), k(y)
+  {
+  }
+
+  long int nr() const
+  {
+    return (long(j)+k)*(long(j)+k+1)/2+j;
+  }
+
+  bool operator == (const Key& vgl) const
+  {
+    return (j == vgl.j && k == vgl.k);
+  }
+};
+
+class Key3
+{
+public:
+  int j, k, l;
+
+  Key3(int x, int y, int z)
+  : j(x), k(y), l(z)
+  {
+  }
+
+  bool operator == (const Key3& vgl) const
+  {
+    return (j == vgl.j && k == vgl.k && l == vgl.l);
+  }
+};
+
+// portable bit interleaving: spread the lower 32 bits of x to the even bits
+inline uint64_t spread_bits_2(uint64_t x)
+{
+  x &= 0x00000000FFFFFFFFull;
+  x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+  x = (x | (x << 8))  & 0x00FF00FF00FF00FFull;
+  x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | (x << 2))  & 0x3333333333333333ull;
+  x = (x | (x << 1))  & 0x5555555555555555ull;
+  return x;
+}
+
+// the inverse of spread_bits_2()
+inline uint64_t compact_bits_2(uint64_t x)
+{
+  x &= 0x5555555555555555ull;
+  x = (x | (x >> 1))  & 0x3333333333333333ull;
+  x = (x | (x >> 2))  & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | (x >> 4))  & 0x00FF00FF00FF00FFull;
+  x = (x | (x >> 8))  & 0x0000FFFF0000FFFFull;
+  x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+  return x;
+}
+
+// spread the lower 21 bits of x to every third bit
+inline uint64_t spread_bits_3(uint64_t x)
+{
+  x &= 0x00000000001FFFFFull;
+  x = (x | (x << 32)) & 0x001F00000000FFFFull;
+  x = (x | (x << 16)) & 0x001F0000FF0000FFull;
+  x = (x | (x << 8))  & 0x100F00F00F00F00Full;
+  x = (x | (x << 4))  & 0x10C30C30C30C30C3ull;
+  x = (x | (x << 2))  & 0x1249249249249249ull;
+  return x;
+}
+
+// the inverse of spread_bits_3()
+inline uint64_t compact_bits_3(uint64_t x)
+{
+  x &= 0x1249249249249249ull;
+  x = (x | (x >> 2))  & 0x10C30C30C30C30C3ull;
+  x = (x | (x >> 4))  & 0x100F00F00F00F00Full;
+  x = (x | (x >> 8))  & 0x001F0000FF0000FFull;
+  x = (x | (x >> 16)) & 0x001F00000000FFFFull;
+  x = (x | (x >> 32)) & 0x00000000001FFFFFull;
+  return x;
+}
+
+/*
+ Morton codes of the keys, the first coordinate occupies the most significant
+ bit of each group. The portable versions are always available, for comparison.
+ */
+inline uint64_t morton_portable(const Key& key)
+{
+  return (spread_bits_2(key.j) << 1) | spread_bits_2(key.k);
+}
+
+// the coordinates of Key3 have 21 bits, larger or negative ones would collide
+inline bool in_morton_range(const Key3& key)
+{
+  const int bound(1 << 21);
+  return key.j >= 0 && key.j < bound && key.k >= 0 && key.k < bound && key.l >= 0 && key.l < bound;
+}
+
+inline uint64_t morton_portable(const Key3& key)
+{
+  assert(in_morton_range(key));
+  return (spread_bits_3(key.j) << 2) | (spread_bits_3(key.k) << 1) | spread_bits_3(key.l);
+}
+
+inline uint64_t morton(const Key& key)
+{
+#if defined(__BMI2__)
+  return _pdep_u64(key.j, 0xAAAAAAAAAAAAAAAAull) | _pdep_u64(key.k, 0x5555555555555555ull);
+#else
+  return morton_portable(key);
+#endif
+}
+
+inline uint64_t morton(const Key3& key)
+{
+  assert(in_morton_range(key));
+#if defined(__BMI2__)
+  return _pdep_u64(key.j, 0x4924924924924924ull) | _pdep_u64(key.k, 0x2492492492492492ull)
+    | _pdep_u64(key.l, 0x1249249249249249ull);
+#else
+  return morton_portable(key);
+#endif
+}
+
+// the inverse mappings of morton()
+inline Key morton_to_key(const uint64_t code)
+{
+#if defined(__BMI2__)
+  return Key(_pext_u64(code, 0xAAAAAAAAAAAAAAAAull), _pext_u64(code, 0x5555555555555555ull));
+#else
+  return Key(compact_bits_2(code >> 1), compact_bits_2(code));
+#endif
+}
+
+inline Key3 morton_to_key3(const uint64_t code)
+{
+#if defined(__BMI2__)
+  return Key3(_pext_u64(code, 0x4924924924924924ull), _pext_u64(code, 0x2492492492492492ull),
+              _pext_u64(code, 0x1249249249249249ull));
+#else
+  return Key3(compact_bits_3(code >> 2), compact_bits_3(code >> 1), compact_bits_3(code));
+#endif
+}
+
+// lexicographical comparison of two tuples
+struct Key_Compare
+{
+  bool operator() (const Key& lhs, const Key& rhs) const
+  {
+    return ((lhs.j < rhs.j) || ((lhs.j == rhs.j) && (lhs.k < rhs.k)));
+  }
+};
+
+// sorting Keys with nr()
+struct Key_Compare2
+{
+  bool operator() (const Key& lhs, const Key& rhs) const
+  {
+    return (lhs.nr() < rhs.nr());
+  }
+};
+
+// sorting Keys along the Z-order curve
+struct Key_Compare_Morton
+{
+  template <class KEY>
+  bool operator() (const KEY& lhs, const KEY& rhs) const
+  {
+    return (morton(lhs) < morton(rhs));
+  }
+};
+
+// hashing Keys via their Morton code
+struct Key_Hash_Morton
+{
+  template <class KEY>
+  size_t operator() (const KEY& key) const
+  {
+    return std::hash<uint64_t>()(morton(key));
+  }
+};
+
+// hashing Keys via nr()
+struct Key_Hash
+{
+  size_t operator() (const Key& key) const
+  {
+    return std::hash<long int>()(key.nr());
+  }
+};
+
+/*
+ Apply the 5-point stencil to the grid function x: traverse x in the order of
+ its container and look up the four neighbours of each entry.
+ */
+template <class MAP>
+double apply_stencil(const MAP& x)
+{
+  double r(0);
+  for (typename MAP::const_iterator it(x.begin()); it != x.end(); ++it)
+  {
+    const Key& key(it->first);
+    double y(4*it->second);
+    typename MAP::const_iterator n;
+    if ((n = x.find(Key(key.j-1, key.k))) != x.end()) y -= n->second;
+    if ((n = x.find(Key(key.j+1, key.k))) != x.end()) y -= n->second;
+    if ((n = x.find(Key(key.j, key.k-1))) != x.end()) y -= n->second;
+    if ((n = x.find(Key(key.j, key.k+1))) != x.end()) y -= n->second;
+    r += y*y;
+  }
+  return r;
+}
+
+// the sum of the values of x at all keys of the stream
+template <class MAP>
+double read_stream(const MAP& x, const access_patterns::Stream<2>& keys)
+{
+  double r(0);
+  for (size_t i=0; i<keys.size(); i++)
+    r += x.find(Key(keys[i][0], keys[i][1]))->second;
+  return r;
+}
+
+template <class MAP>
+void benchmark_stencil(benchmark::Harness& harness, const std::string& name, const int N, const double expected)
+{
+  MAP x;
+  clock_t start=clock();
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      x[Key(j,k)]=(j*k)%7;
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  const double r=apply_stencil(x);
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << name << ": writing " << dur1 << "s, stencil " << dur2 << "s"
+    << (expected < 0 || r == expected ? "" : " (wrong result!)") << "\n";
+  bool correct(true);
+  access_patterns::for_each_pattern<2>(N, N*N, [&] (const access_patterns::Pattern pattern,
+                                                    const access_patterns::Stream<2>& keys) {
+      double expected_read(0);
+      for (size_t i=0; i<keys.size(); i++)
+        expected_read += (keys[i][0]*keys[i][1])%7;
+      double r(0);
+      harness.run(name+", reading ("+access_patterns::name(pattern)+")", keys.size(), [&] () {
+          r=read_stream(x, keys);
+          benchmark::do_not_optimize(r);
+        });
+      correct = correct && r == expected_read;
+    });
+  if (!correct)
+    cout << "  (wrong result!)\n";
+  cout << "\n";
+}
+
+int main(int argc, char** argv)
+{
+  cout << "- the Z-order curve on the first 4x4 keys:";
+  for (uint64_t code=0; code<16; code++)
+  {
+    const Key key(morton_to_key(code));
+    cout << " (" << key.j << "," << key.k << ")";
+  }
+  cout << endl;
+
+#if defined(__BMI2__)
+  cout << "- using BMI2 pdep/pext" << endl;
+#else
+  cout << "- using the portable bit interleaving" << endl;
+#endif
+
+  // check encoding and decoding
+  bool ok(true);
+  for (int j=0; j<300; j++)
+    for (int k=0; k<300; k++)
+    {
+      ok = ok && morton(Key(j,k)) == morton_portable(Key(j,k)) && morton_to_key(morton(Key(j,k))) == Key(j,k);
+      const Key3 key3(j, k, (j*31+k*17)%2000);
+      ok = ok && morton(key3) == morton_portable(key3) && morton_to_key3(morton(key3)) == key3;
+    }
+  ok = ok && morton_to_key(morton(Key(0x7FFFFFFF,0x7FFFFFFF))) == Key(0x7FFFFFFF,0x7FFFFFFF)
+    && morton_to_key3(morton(Key3(0x1FFFFF,0,0x1FFFFF))) == Key3(0x1FFFFF,0,0x1FFFFF);
+  cout << "- do encoding and decoding agree? " << (ok ? "yes" : "no") << endl;
+
+  // timings of the encodings
+  const int M=2000;
+  uint64_t sum1=0, sum2=0;
+  clock_t start=clock();
+  for (int j=0; j<M; j++)
+    for (int k=0; k<M; k++)
+      sum1 += morton(Key(j,k));
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int j=0; j<M; j++)
+    for (int k=0; k<M; k++)
+      sum2 += morton_portable(Key(j,k));
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << "- do the sums of the codes agree? " << (sum1==sum2 ? "yes" : "no") << endl;
+
+  cout << "\nmorton(): " << dur1 << "s\n";
+  cout << "morton_portable(): " << dur2 << "s\n\n";
+
+  // 5-point stencil on an NxN grid with the different orderings
+  const int N=500;
+  std::map<Key,double,Key_Compare> reference;
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      reference[Key(j,k)]=(j*k)%7;
+  const double expected=apply_stencil(reference);
+  benchmark::Harness harness("map_tuple_keys/test_map_morton", argc, argv, 5);
+  benchmark_stencil<std::map<Key,double,Key_Compare> >(harness, "std::map with Key_Compare", N, expected);
+  benchmark_stencil<std::map<Key,double,Key_Compare2> >(harness, "std::map with Key_Compare2", N, expected);
+  benchmark_stencil<std::map<Key,double,Key_Compare_Morton> >
+    (harness, "std::map with Key_Compare_Morton", N, expected);
+  benchmark_stencil<std::unordered_map<Key,double,Key_Hash> >
+    (harness, "std::unordered_map with nr()", N, expected);
+  benchmark_stencil<std::unordered_map<Key,double,Key_Hash_Morton> >
+    (harness, "std::unordered_map with morton()", N, expected);
+
+  return 0;
+}
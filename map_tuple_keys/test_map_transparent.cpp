@@ -0,0 +1,314 @@
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <utility>
+#include "benchmark_harness/benchmark_harness.h"
+#include "access_patterns/access_patterns.h"
+
+/*
+ In this file, we test heterogeneous lookups in containers with tuple keys.
+ So far, every lookup in test_map_NxN.cpp fills a Key object and then
+ searches for it. Since C++14 (std::map) and C++20 (std::unordered_map), the
+ lookup functions find(), count() and contains() also accept arguments of
+ other types than the key type, provided that the comparison object (resp.
+ both the hash function and the equality predicate) declare a type
+ is_transparent and can handle the mixed arguments.
+ 1) Key_Compare compares Keys, pairs (j,k) and KeyViews, i.e., pointers to
+    two coordinates stored elsewhere (e.g., in the coordinate arrays of a
+    mesh), lexicographically, without constructing a Key.
+ 2) CodedKey_Compare, CodedKey_Hash and CodedKey_Equal compare and hash
+    CodedKeys (which store their number nr(j,k), see test_map_NxN.cpp) and
+    plain integer codes, so that codes from an integer-keyed stream can be
+    looked up without recomputing anything.
+ 3) InfiniteVector::get_coefficient() and contains() forward any index type
+    which the comparison object (or the hash function) of CONTAINER accepts.
+ The lookups are timed in the benchmark harness (see
+ benchmark_harness/benchmark_harness.h), in row-major order and with the
+ key streams of access_patterns.h.
+ */
+
+using std::cout;
+using std::endl;
+
+class Key
+{
+public:
+  int j, k;
+
+  Key(int x, int y)
+  : j(x), k(y)
+  {
+  }
+};
+
+// a view of a tuple (j,k), which is stored elsewhere
+struct KeyView
+{
+  const int* x;
+
+  int j() const
+  {
+    return x[0];
+  }
+
+  int k() const
+  {
+    return x[1];
+  }
+};
+
+// uniform access to the coordinates of all kinds of tuples
+inline std::pair<int,int> coordinates(const Key& key)
+{
+  return std::make_pair(key.j, key.k);
+}
+
+inline std::pair<int,int> coordinates(const std::pair<int,int>& key)
+{
+  return key;
+}
+
+inline std::pair<int,int> coordinates(const KeyView& key)
+{
+  return std::make_pair(key.j(), key.k());
+}
+
+// lexicographical comparison of Keys, pairs and KeyViews
+struct Key_Compare
+{
+  typedef void is_transparent;
+
+  template <class KEY1, class KEY2>
+  bool operator() (const KEY1& lhs, const KEY2& rhs) const
+  {
+    return coordinates(lhs) < coordinates(rhs);
+  }
+};
+
+// a tuple (j,k) which stores its number nr(j,k)
+class CodedKey
+{
+public:
+  CodedKey(int x, int y)
+  : j_(x), k_(y), nr_((long(x)+y)*(long(x)+y+1)/2+x)
+  {
+  }
+
+  int j() const
+  {
+    return j_;
+  }
+
+  int k() const
+  {
+    return k_;
+  }
+
+  long int nr() const
+  {
+    return nr_;
+  }
+
+private:
+  int j_, k_;
+  long int nr_;
+};
+
+// the number of CodedKeys and plain codes
+inline long int code(const CodedKey& key)
+{
+  return key.nr();
+}
+
+inline long int code(const long int nr)
+{
+  return nr;
+}
+
+// sorting CodedKeys and codes by their number
+struct CodedKey_Compare
+{
+  typedef void is_transparent;
+
+  template <class KEY1, class KEY2>
+  bool operator() (const KEY1& lhs, const KEY2& rhs) const
+  {
+    return code(lhs) < code(rhs);
+  }
+};
+
+// hashing CodedKeys and codes via their number
+struct CodedKey_Hash
+{
+  typedef void is_transparent;
+
+  template <class KEY>
+  size_t operator() (const KEY& key) const
+  {
+    return std::hash<long int>()(code(key));
+  }
+};
+
+struct CodedKey_Equal
+{
+  typedef void is_transparent;
+
+  template <class KEY1, class KEY2>
+  bool operator() (const KEY1& lhs, const KEY2& rhs) const
+  {
+    return code(lhs) == code(rhs);
+  }
+};
+
+template <class C, class I, class CONTAINER=std::map<I,C> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  void set_coefficient(const I& index, const C value)
+  {
+    CONTAINER::insert_or_assign(index, value);
+  }
+
+  // read access with any index type that CONTAINER can look up directly
+  template <class INDEX>
+  C get_coefficient(const INDEX& index) const
+  {
+    typename CONTAINER::const_iterator it(CONTAINER::find(index));
+    return (it == CONTAINER::end() ? C(0) : it->second);
+  }
+
+  template <class INDEX>
+  bool contains(const INDEX& index) const
+  {
+    return CONTAINER::contains(index);
+  }
+};
+
+// the same indices in different representations
+struct Representations
+{
+  std::vector<Key> keys;
+  std::vector<std::pair<int,int> > pairs;
+  std::vector<int> coordinate_array; // j_0,k_0,j_1,k_1,...
+  std::vector<KeyView> views;
+  std::vector<CodedKey> coded_keys;
+  std::vector<long int> codes;
+
+  void push_back(const int j, const int k)
+  {
+    keys.push_back(Key(j,k));
+    pairs.push_back(std::make_pair(j,k));
+    coordinate_array.push_back(j);
+    coordinate_array.push_back(k);
+    coded_keys.push_back(CodedKey(j,k));
+    codes.push_back(CodedKey(j,k).nr());
+  }
+
+  // the views into coordinate_array, once all indices have been added
+  void make_views()
+  {
+    views.clear();
+    for (size_t i=0; i<pairs.size(); i++)
+      views.push_back(KeyView{&coordinate_array[2*i]});
+  }
+};
+
+// sum up the coefficients at the given indices, and time it
+template <class VECTOR, class INDICES>
+void time_lookups(benchmark::Harness& harness, const std::string& name, const VECTOR& v,
+                  const INDICES& indices, double& sum)
+{
+  harness.run(name, indices.size(), [&] () {
+      sum=0;
+      for (typename INDICES::const_iterator it(indices.begin()); it != indices.end(); ++it)
+        sum += v.get_coefficient(*it);
+      benchmark::do_not_optimize(sum);
+    });
+}
+
+int main(int argc, char** argv)
+{
+  const int N=500;
+  InfiniteVector<float,Key,std::map<Key,float,Key_Compare> > v;
+  InfiniteVector<float,CodedKey,std::map<CodedKey,float,CodedKey_Compare> > w;
+  InfiniteVector<float,CodedKey,std::unordered_map<CodedKey,float,CodedKey_Hash,CodedKey_Equal> > u;
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+    {
+      v.set_coefficient(Key(j,k), 1);
+      w.set_coefficient(CodedKey(j,k), 1);
+      u.set_coefficient(CodedKey(j,k), 1);
+    }
+
+  Representations indices;
+  for (int j=1; j<N; j++)
+    for (int k=1; k<N; k++)
+      indices.push_back(j, k);
+  indices.make_views();
+
+  cout << "- does v contain (3,4), given as a pair and as a view? "
+    << (v.contains(std::make_pair(3,4)) && v.contains(KeyView{&indices.coordinate_array[2*(2*(N-1)+3)]})
+        ? "yes" : "no") << endl;
+  cout << "- does w contain the code " << CodedKey(3,4).nr() << "? "
+    << (w.contains(CodedKey(3,4).nr()) && u.contains(CodedKey(3,4).nr()) ? "yes" : "no") << endl;
+
+  // lookups with materialized keys, as in test_map_NxN.cpp
+  benchmark::Harness harness("map_tuple_keys/test_map_transparent", argc, argv, 5);
+  double r1, r2, r3, r4, r5, r6, r7, r8;
+  cout << endl;
+  harness.run("std::map with Key_Compare, filling a Key", (N-1)*(N-1), [&] () {
+      Key It(0,0);
+      r1=0;
+      for (int j=1; j<N; j++)
+        for (int k=1; k<N; k++)
+        {
+          It.j=j;
+          It.k=k;
+          r1 += v.get_coefficient(It);
+        }
+      benchmark::do_not_optimize(r1);
+    });
+  time_lookups(harness, "std::map with Key_Compare, stored Keys", v, indices.keys, r2);
+  time_lookups(harness, "std::map with Key_Compare, pairs (j,k)", v, indices.pairs, r3);
+  time_lookups(harness, "std::map with Key_Compare, KeyViews", v, indices.views, r4);
+  cout << endl;
+
+  harness.run("std::map with CodedKey_Compare, constructing a CodedKey", (N-1)*(N-1), [&] () {
+      r5=0;
+      for (int j=1; j<N; j++)
+        for (int k=1; k<N; k++)
+          r5 += w.get_coefficient(CodedKey(j,k));
+      benchmark::do_not_optimize(r5);
+    });
+  time_lookups(harness, "std::map with CodedKey_Compare, codes", w, indices.codes, r6);
+  cout << endl;
+
+  time_lookups(harness, "std::unordered_map with CodedKey_Hash, stored CodedKeys", u, indices.coded_keys, r7);
+  time_lookups(harness, "std::unordered_map with CodedKey_Hash, codes", u, indices.codes, r8);
+  bool equal(r1 == (N-1)*(N-1) && r2 == r1 && r3 == r1 && r4 == r1 && r5 == r1 && r6 == r1 && r7 == r1 && r8 == r1);
+
+  // the stored representations, with the key streams of access_patterns.h
+  access_patterns::for_each_pattern<2>(N, (N-1)*(N-1), [&] (const access_patterns::Pattern pattern,
+                                                            const access_patterns::Stream<2>& keys) {
+      Representations streamed;
+      for (size_t i=0; i<keys.size(); i++)
+        streamed.push_back(keys[i][0], keys[i][1]);
+      streamed.make_views();
+      const std::string suffix=std::string(" (")+access_patterns::name(pattern)+")";
+      cout << endl;
+      time_lookups(harness, "std::map with Key_Compare, stored Keys"+suffix, v, streamed.keys, r2);
+      time_lookups(harness, "std::map with Key_Compare, pairs (j,k)"+suffix, v, streamed.pairs, r3);
+      time_lookups(harness, "std::map with Key_Compare, KeyViews"+suffix, v, streamed.views, r4);
+      time_lookups(harness, "std::map with CodedKey_Compare, codes"+suffix, w, streamed.codes, r6);
+      time_lookups(harness, "std::unordered_map with CodedKey_Hash, stored CodedKeys"+suffix, u, streamed.coded_keys, r7);
+      time_lookups(harness, "std::unordered_map with CodedKey_Hash, codes"+suffix, u, streamed.codes, r8);
+      equal = equal && r2 == keys.size() && r3 == r2 && r4 == r2 && r6 == r2 && r7 == r2 && r8 == r2;
+    });
+
+  cout << "\n- do all lookups give the same result? " << (equal ? "yes" : "no") << endl;
+
+  return 0;
+}
@@ -0,0 +1,297 @@
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cassert>
+#include <time.h>
+#include <math.h>
+
+/*
+ In this file, we test how to get the tuples (j,k) and (j,k,l) back from their
+ Cantor enumerations
+   nr(j,k)=(j+k)*(j+k+1)/2+j,
+   nr(j,k,l)=T(j+k+l)+nr(j,k), T(s)=s*(s+1)*(s+2)/6,
+ as they are stored in map_int and unordered_map_int in test_map_NxN.cpp and
+ test_map_NxNxN.cpp. Unranking n means finding the largest s with
+ s*(s+1)/2<=n (resp. T(s)<=n), which has so far been done by a search or by
+ floating-point sqrt()/cbrt() alone, which is not exact for large codes.
+ We provide three exact integer variants:
+ 1) unrank2_table()/unrank3_table() find s by a binary search in a table of
+    triangular (resp. tetrahedral) numbers, computed at compile time. They are
+    constexpr, so that they can be used to build other tables.
+ 2) unrank2()/unrank3() take the floating-point guess for s and correct it
+    with integer arithmetic, which costs one sqrt() (resp. cbrt()) and a few
+    multiplications.
+ 3) The batched versions unrank2()/unrank3() for spans of codes do the same in
+    loops without branches, one correction step in each direction, which is
+    exact for codes below 2^50. The 2D loop is vectorized by GCC, provided
+    that sqrt() does not have to set errno and that the target can convert
+    between long int and double in vector registers, e.g., with
+    -O3 -fno-math-errno -march=native on AVX-512 machines. Since cbrt() has no
+    vector version in libm, the 3D guess divides the exponent by 3 and refines
+    it by Newton steps; this loop is free of branches and library calls.
+ Finally, we compare the costs of traversing a code-keyed unordered_map with
+ and without recovering the structured indices.
+ */
+
+using std::cout;
+using std::endl;
+
+class Key
+{
+public:
+  int j, k;
+
+  constexpr Key(int x, int y)
+  : j(x), k(y)
+  {
+  }
+
+  constexpr long int nr() const
+  {
+    return (long(j)+k)*(long(j)+k+1)/2+j;
+  }
+
+  constexpr bool operator == (const Key& vgl) const
+  {
+    return (j == vgl.j && k == vgl.k);
+  }
+};
+
+class Key3
+{
+public:
+  int j, k, l;
+
+  constexpr Key3(int x, int y, int z)
+  : j(x), k(y), l(z)
+  {
+  }
+
+  constexpr long int nr() const
+  {
+    const long int s(long(j)+k+l);
+    return s*(s+1)*(s+2)/6+(long(j)+k)*(long(j)+k+1)/2+j;
+  }
+
+  constexpr bool operator == (const Key3& vgl) const
+  {
+    return (j == vgl.j && k == vgl.k && l == vgl.l);
+  }
+};
+
+constexpr long int triangular(const long int s)
+{
+  return s*(s+1)/2;
+}
+
+constexpr long int tetrahedral(const long int s)
+{
+  return s*(s+1)*(s+2)/6;
+}
+
+// the triangular and tetrahedral numbers for s=0,...,SMAX
+template <int SMAX>
+struct SimplexNumbers
+{
+  long int triangular[SMAX+1], tetrahedral[SMAX+1];
+
+  constexpr SimplexNumbers()
+  : triangular(), tetrahedral()
+  {
+    for (int s = 0; s <= SMAX; s++)
+    {
+      triangular[s] = ::triangular(s);
+      tetrahedral[s] = ::tetrahedral(s);
+    }
+  }
+};
+
+constexpr int SMAX = 4096;
+constexpr SimplexNumbers<SMAX> simplex_numbers;
+
+// table-assisted unranking, for codes n<triangular(SMAX+1) (resp. tetrahedral(SMAX+1))
+constexpr Key unrank2_table(const long int n)
+{
+  assert(n >= 0 && n < triangular(SMAX+1));
+  const long int s(std::upper_bound(simplex_numbers.triangular, simplex_numbers.triangular+SMAX+1, n)
+                   - simplex_numbers.triangular - 1);
+  const int j(n - simplex_numbers.triangular[s]);
+  return Key(j, s-j);
+}
+
+constexpr Key3 unrank3_table(const long int n)
+{
+  assert(n >= 0 && n < tetrahedral(SMAX+1));
+  const long int s(std::upper_bound(simplex_numbers.tetrahedral, simplex_numbers.tetrahedral+SMAX+1, n)
+                   - simplex_numbers.tetrahedral - 1);
+  const Key key(unrank2_table(n - simplex_numbers.tetrahedral[s]));
+  return Key3(key.j, key.k, s-key.j-key.k);
+}
+
+static_assert(unrank2_table(Key(3,4).nr()) == Key(3,4));
+static_assert(unrank3_table(Key3(5,0,7).nr()) == Key3(5,0,7));
+
+// floating-point guess for s, corrected with integer arithmetic
+inline Key unrank2(const long int n)
+{
+  long int s((long int)((sqrt(8.0*n+1)-1)/2));
+  while (triangular(s+1) <= n) s++;
+  while (triangular(s) > n) s--;
+  const int j(n - triangular(s));
+  return Key(j, s-j);
+}
+
+// tetrahedral(s) multiplies before dividing by 6, so that s*(s+1)*(s+2) must fit into
+// a long int for the guess s=cbrt(6n)<=2^21-3 and s+1, i.e., n<tetrahedral(2^21-3)
+constexpr long int unrank3_bound = tetrahedral((1l << 21) - 3);
+
+// for codes n<unrank3_bound (about 1.5e18)
+inline Key3 unrank3(const long int n)
+{
+  assert(n >= 0 && n < unrank3_bound);
+  long int s((long int)cbrt(6.0*n));
+  while (tetrahedral(s+1) <= n) s++;
+  while (tetrahedral(s) > n) s--;
+  const Key key(unrank2(n - tetrahedral(s)));
+  return Key3(key.j, key.k, s-key.j-key.k);
+}
+
+// batched unranking of codes n<2^50 into separate arrays of coordinates
+void unrank2(std::span<const long int> codes, std::span<int> j, std::span<int> k)
+{
+  for (size_t i = 0; i < codes.size(); i++)
+  {
+    const long int n(codes[i]);
+    long int s((long int)((sqrt(8.0*n+1)-1)/2));
+    s += (triangular(s+1) <= n);
+    s -= (triangular(s) > n);
+    j[i] = n - triangular(s);
+    k[i] = s - j[i];
+  }
+}
+
+void unrank3(std::span<const long int> codes, std::span<int> j, std::span<int> k, std::span<int> l)
+{
+  for (size_t i = 0; i < codes.size(); i++)
+  {
+    const long int n(codes[i]);
+    // cube root of 6n+1: divide the exponent by 3 (as in fdlibm), then three Newton steps
+    const double a(6.0*n+1);
+    double x(std::bit_cast<double>(((std::bit_cast<uint64_t>(a) >> 32)/3 + 715094163ull) << 32));
+    x = (2*x + a/(x*x))/3;
+    x = (2*x + a/(x*x))/3;
+    x = (2*x + a/(x*x))/3;
+    long int s((long int)x);
+    s -= (tetrahedral(s) > n);
+    s += (tetrahedral(s+1) <= n);
+    const long int r(n - tetrahedral(s));
+    long int t((long int)((sqrt(8.0*r+1)-1)/2));
+    t += (triangular(t+1) <= r);
+    t -= (triangular(t) > r);
+    j[i] = r - triangular(t);
+    k[i] = t - j[i];
+    l[i] = s - t;
+  }
+}
+
+int main()
+{
+  // check all variants against nr()
+  bool ok(true);
+  const long int M=1000000;
+  std::vector<long int> codes(M);
+  std::vector<int> bj(M), bk(M), bl(M);
+  for (long int n=0; n<M; n++)
+    codes[n]=n;
+  unrank2(codes, bj, bk);
+  for (long int n=0; n<M; n++)
+    ok = ok && unrank2(n).nr() == n && unrank2_table(n) == unrank2(n) && Key(bj[n],bk[n]) == unrank2(n);
+  unrank3(codes, bj, bk, bl);
+  for (long int n=0; n<M; n++)
+    ok = ok && unrank3(n).nr() == n && unrank3_table(n) == unrank3(n) && Key3(bj[n],bk[n],bl[n]) == unrank3(n);
+  cout << "- do all unrankings invert nr() on [0," << M << ")? " << (ok ? "yes" : "no") << endl;
+
+  // large codes, where floating-point arithmetic alone is not exact
+  const Key big(1<<30, (1<<30)-1);
+  const Key3 big3(1<<19, 12345, (1<<19)-1);
+  codes[0]=big.nr();
+  codes[1]=big3.nr();
+  unrank2(std::span<const long int>(codes.data(), 1), bj, bk);
+  unrank3(std::span<const long int>(codes.data()+1, 1), bj, bk, bl);
+  cout << "- are large codes unranked exactly? "
+    << (unrank2(big.nr()) == big && unrank3(big3.nr()) == big3 && Key3(bj[0],bk[0],bl[0]) == big3 ? "yes" : "no")
+    << endl;
+
+  // traverse an unordered_map with integer codes of a 3D grid
+  const int N=100;
+  std::unordered_map<long int,double> unordered_map_int;
+  for (int j=0; j<N; j++)
+    for (int k=0; k<N; k++)
+      for (int l=0; l<N; l++)
+        unordered_map_int[Key3(j,k,l).nr()]=1.0/(1+j);
+
+  const int repetitions=10;
+  double r1=0, r2=0, r3=0, r4=0;
+  clock_t start=clock();
+  for (int r=0; r<repetitions; r++)
+    for (const auto& entry : unordered_map_int)
+      r1 += entry.second;
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    for (const auto& entry : unordered_map_int)
+    {
+      const Key3 key(unrank3_table(entry.first));
+      r2 += entry.second*(1+key.j);
+    }
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    for (const auto& entry : unordered_map_int)
+    {
+      const Key3 key(unrank3(entry.first));
+      r3 += entry.second*(1+key.j);
+    }
+  const double dur3=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  // batched: gather blocks of codes and values, then unrank them at once
+  const size_t B=256;
+  long int block_codes[B];
+  double block_values[B];
+  int block_j[B], block_k[B], block_l[B];
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+  {
+    size_t length=0;
+    std::unordered_map<long int,double>::const_iterator it(unordered_map_int.begin());
+    while (it != unordered_map_int.end())
+    {
+      for (length=0; length<B && it != unordered_map_int.end(); ++it, length++)
+      {
+        block_codes[length]=it->first;
+        block_values[length]=it->second;
+      }
+      unrank3(std::span<const long int>(block_codes, length), block_j, block_k, block_l);
+      for (size_t i=0; i<length; i++)
+        r4 += block_values[i]*(1+block_j[i]);
+    }
+  }
+  const double dur4=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  cout << "- do the sums agree? "
+    << (r2 == repetitions*double(N*N*N) && r3 == r2 && r4 == r2 && r1 > 0 ? "yes" : "no") << endl;
+
+  cout << "\nreading the values only: " << dur1 << "s\n";
+  cout << "reading the values and unranking with the table: " << dur2 << "s\n";
+  cout << "reading the values and unranking with cbrt(): " << dur3 << "s\n";
+  cout << "reading the values and unranking in blocks of " << B << ": " << dur4 << "s\n";
+
+  return 0;
+}
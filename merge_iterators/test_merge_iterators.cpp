@@ -0,0 +1,439 @@
+#include <iostream>
+#include <map>
+#include <iterator>
+#include <cmath>
+#include <time.h>
+
+/*
+ Nearly all binary BLAS level 1 kernels on InfiniteVector (axpy, inner
+ products, distances, comparisons) have to walk through the supports of two
+ vectors x and y in index order and look at triples (index, x_i or nothing,
+ y_i or nothing). Written by hand, every such kernel repeats the same nested
+ if/else cascade; written with get_coefficient(), it costs one lookup per entry.
+
+ In this design test program, we work out a merge iterator
+ InfiniteVectorMergeIterator on top of two InfiniteVectorConstIterators, in
+ three modes:
+ - merge_union: all indices from the support of x or of y,
+ - merge_intersection: the indices in both supports,
+ - merge_left: the indices in the support of x (left join).
+ Dereferencing yields a MergeEntry (index, pointer to x_i, pointer to y_i),
+ the pointers being nullptr if the coefficient is zero. The mode is a
+ template parameter, so that the compiler only sees the comparisons it needs.
+ In the union mode, the next entry is determined with two comparisons and
+ conditional assignments, and an increment advances each side by a boolean,
+ which leaves the compiler with branch-light loops. The function
+ merge<MODE>(x,y) returns a range which can be used in range-based for loops,
+ with std::default_sentinel as its end.
+ */
+
+using std::cout;
+using std::endl;
+
+// forward declaration of InfiniteVector iterators
+template <class C, class I, class CONTAINER> class InfiniteVectorConstIterator;
+
+template <class C, class I=int, class CONTAINER=std::map<I,C> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  friend class InfiniteVectorConstIterator<C,I,CONTAINER>;
+  typedef InfiniteVectorConstIterator<C,I,CONTAINER> const_iterator;
+  typedef typename CONTAINER::key_compare key_compare;
+
+  typedef typename CONTAINER::value_type value_type;
+
+  const_iterator begin() const
+  {
+    return const_iterator(*this, CONTAINER::begin());
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(*this, CONTAINER::end());
+  }
+
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  void clear()
+  {
+    CONTAINER::clear();
+  }
+
+  C get_coefficient(const I& index) const
+  {
+    typename CONTAINER::const_iterator it(CONTAINER::find(index));
+    return (it == CONTAINER::end() ? C(0) : it->second);
+  }
+
+  void set_coefficient(const I& index, const C value)
+  {
+    CONTAINER::operator [] (index) = value;
+  }
+
+  // append an entry with an index larger than all stored ones, in O(1)
+  void push_back(const I& index, const C value)
+  {
+    CONTAINER::emplace_hint(CONTAINER::end(), index, value);
+  }
+};
+
+template <class C, class I, class CONTAINER>
+class InfiniteVectorConstIterator
+: protected CONTAINER::const_iterator
+{
+public:
+  typedef typename CONTAINER::const_iterator::iterator_category iterator_category;
+  typedef typename CONTAINER::const_iterator::difference_type difference_type;
+  typedef typename CONTAINER::const_iterator::value_type value_type;
+  typedef typename CONTAINER::const_iterator::pointer pointer;
+  typedef typename CONTAINER::const_iterator::reference reference;
+
+private:
+  // a pointer (instead of a reference), so that iterators are assignable
+  const InfiniteVector<C,I,CONTAINER>* _container;
+
+public:
+  InfiniteVectorConstIterator()
+  : CONTAINER::const_iterator(), _container(nullptr)
+  {
+  }
+
+  InfiniteVectorConstIterator(const InfiniteVector<C,I,CONTAINER>& container,
+                              typename CONTAINER::const_iterator state)
+  : CONTAINER::const_iterator(state), _container(&container)
+  {
+  }
+
+  bool operator == (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+  {
+    return (static_cast<typename CONTAINER::const_iterator>(*this)
+            == static_cast<typename CONTAINER::const_iterator>(it));
+  }
+
+  bool operator != (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+  {
+    return !(*this == it);
+  }
+
+  InfiniteVectorConstIterator<C,I,CONTAINER>& operator ++ ()
+  {
+    CONTAINER::const_iterator::operator ++ ();
+    return *this;
+  }
+
+  const I& index() const
+  {
+    return (CONTAINER::const_iterator::operator * ()).first;
+  }
+
+  const C& value() const
+  {
+    return (CONTAINER::const_iterator::operator * ()).second;
+  }
+
+  const reference operator * () const
+  {
+    return CONTAINER::const_iterator::operator * ();
+  }
+};
+
+enum MergeMode { merge_union, merge_intersection, merge_left };
+
+// one entry of a merged traversal, x or y being nullptr if the coefficient is zero
+template <class C, class I>
+struct MergeEntry
+{
+  I index;
+  const C* x;
+  const C* y;
+};
+
+template <class C, class I, class CONTAINER, MergeMode MODE>
+class InfiniteVectorMergeIterator
+{
+public:
+  typedef std::forward_iterator_tag iterator_category;
+  typedef std::ptrdiff_t difference_type;
+  typedef MergeEntry<C,I> value_type;
+  typedef const value_type* pointer;
+  typedef const value_type& reference;
+
+  typedef typename InfiniteVector<C,I,CONTAINER>::const_iterator const_iterator;
+
+private:
+  const_iterator _xit, _xend, _yit, _yend;
+  typename InfiniteVector<C,I,CONTAINER>::key_compare _less;
+  value_type _current;
+  bool _done;
+
+  // determine the current entry, starting from the current positions
+  void settle()
+  {
+    if constexpr (MODE == merge_union)
+    {
+      const bool xvalid(_xit != _xend), yvalid(_yit != _yend);
+      _done = !(xvalid || yvalid);
+      if (_done)
+        return;
+      // x is taken if y is exhausted or x_i <= y_i, y if x is exhausted or y_i <= x_i
+      const bool takex(xvalid && (!yvalid || !_less(_yit.index(), _xit.index())));
+      const bool takey(yvalid && (!xvalid || !_less(_xit.index(), _yit.index())));
+      _current.index = (takex ? _xit.index() : _yit.index());
+      _current.x = (takex ? &_xit.value() : nullptr);
+      _current.y = (takey ? &_yit.value() : nullptr);
+    }
+    else if constexpr (MODE == merge_intersection)
+    {
+      while (_xit != _xend && _yit != _yend)
+      {
+        const bool xless(_less(_xit.index(), _yit.index()));
+        const bool yless(_less(_yit.index(), _xit.index()));
+        if (!(xless || yless))
+          break;
+        if (xless)
+          ++_xit;
+        else
+          ++_yit;
+      }
+      _done = (_xit == _xend || _yit == _yend);
+      if (_done)
+        return;
+      _current.index = _xit.index();
+      _current.x = &_xit.value();
+      _current.y = &_yit.value();
+    }
+    else // merge_left
+    {
+      _done = (_xit == _xend);
+      if (_done)
+        return;
+      for (; _yit != _yend && _less(_yit.index(), _xit.index()); ++_yit);
+      const bool match(_yit != _yend && !_less(_xit.index(), _yit.index()));
+      _current.index = _xit.index();
+      _current.x = &_xit.value();
+      _current.y = (match ? &_yit.value() : nullptr);
+    }
+  }
+
+public:
+  InfiniteVectorMergeIterator()
+  : _done(true)
+  {
+  }
+
+  InfiniteVectorMergeIterator(const InfiniteVector<C,I,CONTAINER>& x,
+                              const InfiniteVector<C,I,CONTAINER>& y)
+  : _xit(x.begin()), _xend(x.end()), _yit(y.begin()), _yend(y.end()), _less(), _done(false)
+  {
+    settle();
+  }
+
+  bool operator == (std::default_sentinel_t) const
+  {
+    return _done;
+  }
+
+  bool operator == (const InfiniteVectorMergeIterator<C,I,CONTAINER,MODE>& it) const
+  {
+    return (_done && it._done)
+      || (!_done && !it._done && _xit == it._xit && _yit == it._yit);
+  }
+
+  InfiniteVectorMergeIterator<C,I,CONTAINER,MODE>& operator ++ ()
+  {
+    // advance each side whose entry has just been visited
+    if (_current.x)
+      ++_xit;
+    if (_current.y)
+      ++_yit;
+    settle();
+    return *this;
+  }
+
+  InfiniteVectorMergeIterator<C,I,CONTAINER,MODE> operator ++ (int)
+  {
+    InfiniteVectorMergeIterator<C,I,CONTAINER,MODE> r(*this);
+    ++(*this);
+    return r;
+  }
+
+  reference operator * () const
+  {
+    return _current;
+  }
+
+  pointer operator -> () const
+  {
+    return &_current;
+  }
+};
+
+// the merged traversal of two vectors as a range
+template <class C, class I, class CONTAINER, MergeMode MODE>
+class InfiniteVectorMerge
+{
+public:
+  typedef InfiniteVectorMergeIterator<C,I,CONTAINER,MODE> iterator;
+
+  InfiniteVectorMerge(const InfiniteVector<C,I,CONTAINER>& x, const InfiniteVector<C,I,CONTAINER>& y)
+  : _x(x), _y(y)
+  {
+  }
+
+  iterator begin() const
+  {
+    return iterator(_x, _y);
+  }
+
+  std::default_sentinel_t end() const
+  {
+    return std::default_sentinel;
+  }
+
+private:
+  const InfiniteVector<C,I,CONTAINER>& _x;
+  const InfiniteVector<C,I,CONTAINER>& _y;
+};
+
+template <MergeMode MODE, class C, class I, class CONTAINER>
+InfiniteVectorMerge<C,I,CONTAINER,MODE> merge(const InfiniteVector<C,I,CONTAINER>& x,
+                                              const InfiniteVector<C,I,CONTAINER>& y)
+{
+  return InfiniteVectorMerge<C,I,CONTAINER,MODE>(x, y);
+}
+
+// some BLAS level 1 kernels, written with the merge iterator
+
+// inner product <x,y>
+template <class C, class I, class CONTAINER>
+C dot(const InfiniteVector<C,I,CONTAINER>& x, const InfiniteVector<C,I,CONTAINER>& y)
+{
+  C r(0);
+  for (const MergeEntry<C,I>& e : merge<merge_intersection>(x, y))
+    r += *e.x * *e.y;
+  return r;
+}
+
+// z = x + alpha*y, z is built in index order with O(1) insertions
+template <class C, class I, class CONTAINER>
+void axpy(const InfiniteVector<C,I,CONTAINER>& x, const C alpha,
+          const InfiniteVector<C,I,CONTAINER>& y, InfiniteVector<C,I,CONTAINER>& z)
+{
+  z.clear();
+  for (const MergeEntry<C,I>& e : merge<merge_union>(x, y))
+    z.push_back(e.index, (e.x ? *e.x : C(0)) + alpha * (e.y ? *e.y : C(0)));
+}
+
+// ||x-y||_2
+template <class C, class I, class CONTAINER>
+double l2_distance(const InfiniteVector<C,I,CONTAINER>& x, const InfiniteVector<C,I,CONTAINER>& y)
+{
+  double r(0);
+  for (const MergeEntry<C,I>& e : merge<merge_union>(x, y))
+  {
+    const C d((e.x ? *e.x : C(0)) - (e.y ? *e.y : C(0)));
+    r += d*d;
+  }
+  return sqrt(r);
+}
+
+// x == y, treating stored zeros like missing entries
+template <class C, class I, class CONTAINER>
+bool equal(const InfiniteVector<C,I,CONTAINER>& x, const InfiniteVector<C,I,CONTAINER>& y)
+{
+  for (const MergeEntry<C,I>& e : merge<merge_union>(x, y))
+    if ((e.x ? *e.x : C(0)) != (e.y ? *e.y : C(0)))
+      return false;
+  return true;
+}
+
+// z_i = x_i*y_i on the support of x (e.g., masking y with the support of x)
+template <class C, class I, class CONTAINER>
+void multiply_on_support(const InfiniteVector<C,I,CONTAINER>& x, const InfiniteVector<C,I,CONTAINER>& y,
+                         InfiniteVector<C,I,CONTAINER>& z)
+{
+  z.clear();
+  for (const MergeEntry<C,I>& e : merge<merge_left>(x, y))
+    z.push_back(e.index, *e.x * (e.y ? *e.y : C(0)));
+}
+
+int main()
+{
+  const int N=200000;
+  InfiniteVector<double,int> x, y;
+  for (int i=0; i<N; i++)
+  {
+    if (i%2 == 0) x.set_coefficient(i, 1.0+(i%7));
+    if (i%3 == 0) y.set_coefficient(i, 2.0-(i%5));
+  }
+
+  cout << "- the merged supports of x=(1,0,3) and y=(2,0,0,-1):" << endl;
+  InfiniteVector<double,int> a, b;
+  a.set_coefficient(0, 1.0);
+  a.set_coefficient(2, 3.0);
+  b.set_coefficient(0, 2.0);
+  b.set_coefficient(3, -1.0);
+  cout << "  union:";
+  for (const MergeEntry<double,int>& e : merge<merge_union>(a, b))
+    cout << " (" << e.index << "," << (e.x ? *e.x : 0.0) << "," << (e.y ? *e.y : 0.0) << ")";
+  cout << endl << "  intersection:";
+  for (const MergeEntry<double,int>& e : merge<merge_intersection>(a, b))
+    cout << " (" << e.index << "," << *e.x << "," << *e.y << ")";
+  cout << endl << "  left join:";
+  for (const MergeEntry<double,int>& e : merge<merge_left>(a, b))
+    cout << " (" << e.index << "," << *e.x << "," << (e.y ? *e.y : 0.0) << ")";
+  cout << endl;
+
+  const int repetitions=10;
+
+  // the same kernels with one lookup per entry
+  clock_t start=clock();
+  double d1=0;
+  for (int r=0; r<repetitions; r++)
+  {
+    d1=0;
+    for (InfiniteVector<double,int>::const_iterator it(x.begin()); it != x.end(); ++it)
+      d1 += it.value() * y.get_coefficient(it.index());
+  }
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  start=clock();
+  double d2=0;
+  for (int r=0; r<repetitions; r++)
+    d2=dot(x, y);
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  InfiniteVector<double,int> z1, z2;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+  {
+    z1=x;
+    for (InfiniteVector<double,int>::const_iterator it(y.begin()); it != y.end(); ++it)
+      z1.set_coefficient(it.index(), z1.get_coefficient(it.index()) + 0.5*it.value());
+  }
+  const double dur3=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    axpy(x, 0.5, y, z2);
+  const double dur4=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  cout << "- inner products agree? " << (d1==d2 ? "yes" : "no") << endl;
+  cout << "- axpy results agree? " << (equal(z1, z2) ? "yes" : "no")
+    << ", ||z1-z2||=" << l2_distance(z1, z2) << ", ||x-y||=" << l2_distance(x, y) << endl;
+  InfiniteVector<double,int> m;
+  multiply_on_support(x, y, m);
+  cout << "- x.*y on the support of x has " << m.size() << " entries" << endl;
+
+  cout << "\ninner product with lookups: " << dur1 << "s\n";
+  cout << "inner product with the merge iterator: " << dur2 << "s\n";
+  cout << "axpy with lookups: " << dur3 << "s\n";
+  cout << "axpy with the merge iterator: " << dur4 << "s\n";
+
+  return 0;
+}
@@ -0,0 +1,395 @@
+#include <iostream>
+#include <map>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <time.h>
+
+/*
+ When a linear system has to be solved for many right-hand sides at once, and
+ all of them live on nearly the same index set, storing each of them in an
+ InfiniteVector of its own duplicates the indices (and the tree nodes) K times.
+ Worse, every BLAS operation on the K vectors searches and walks the same
+ index structure K times.
+
+ In this design test program, we work out a multi-vector class
+ InfiniteMultiVector<C,I,K> which stores one index per entry, followed by the K
+ contiguous values of all columns, i.e., CONTAINER defaults to
+ std::map<I,std::array<C,K> >. All operations (axpy, the columnwise inner
+ products, and the application of a sparse matrix) process the K columns with
+ a single index lookup. The innermost loops run over the K contiguous values
+ with a compile-time trip count, so that the compiler can vectorize them.
+ We compare this with K separate instances of InfiniteVector.
+ */
+
+using std::cout;
+using std::endl;
+
+template <class C, class I=int, class CONTAINER=std::map<I,C> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  typedef typename CONTAINER::const_iterator const_iterator;
+  typedef typename CONTAINER::value_type value_type;
+
+  const_iterator begin() const
+  {
+    return CONTAINER::begin();
+  }
+
+  const_iterator end() const
+  {
+    return CONTAINER::end();
+  }
+
+  const_iterator find(const I& index) const
+  {
+    return CONTAINER::find(index);
+  }
+
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  void clear()
+  {
+    CONTAINER::clear();
+  }
+
+  C get_coefficient(const I& index) const
+  {
+    const_iterator it(CONTAINER::find(index));
+    return (it == CONTAINER::end() ? C(0) : it->second);
+  }
+
+  void set_coefficient(const I& index, const C value)
+  {
+    CONTAINER::operator [] (index) = value;
+  }
+
+  // *this += alpha*v, merging the two sorted supports
+  void add(const C alpha, const InfiniteVector<C,I,CONTAINER>& v)
+  {
+    typename CONTAINER::iterator hint(CONTAINER::begin());
+    for (const_iterator it(v.begin()); it != v.end(); ++it)
+    {
+      while (hint != CONTAINER::end() && hint->first < it->first)
+        ++hint;
+      if (hint != CONTAINER::end() && hint->first == it->first)
+        hint->second += alpha * it->second;
+      else
+        CONTAINER::emplace_hint(hint, it->first, alpha * it->second);
+    }
+  }
+
+  // inner product, walking through both sorted supports simultaneously
+  C operator * (const InfiniteVector<C,I,CONTAINER>& v) const
+  {
+    C r(0);
+    const_iterator it(begin()), vit(v.begin());
+    while (it != end() && vit != v.end())
+    {
+      if (it->first < vit->first)
+        ++it;
+      else if (vit->first < it->first)
+        ++vit;
+      else
+        r += (it++)->second * (vit++)->second;
+    }
+    return r;
+  }
+};
+
+template <class C, class I=int, size_t K=1, class CONTAINER=std::map<I,std::array<C,K> > >
+class InfiniteMultiVector
+  : protected CONTAINER
+{
+public:
+  typedef typename CONTAINER::const_iterator const_iterator;
+  typedef typename CONTAINER::value_type value_type;
+
+  // the values of all K columns at one index
+  typedef std::array<C,K> Values;
+
+  static constexpr size_t columns()
+  {
+    return K;
+  }
+
+  const_iterator begin() const
+  {
+    return CONTAINER::begin();
+  }
+
+  const_iterator end() const
+  {
+    return CONTAINER::end();
+  }
+
+  const_iterator find(const I& index) const
+  {
+    return CONTAINER::find(index);
+  }
+
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  void clear()
+  {
+    CONTAINER::clear();
+  }
+
+  C get_coefficient(const I& index, const unsigned int column) const
+  {
+    const_iterator it(CONTAINER::find(index));
+    return (it == CONTAINER::end() ? C(0) : it->second[column]);
+  }
+
+  // sets one coefficient, the other columns of a new entry are zero
+  void set_coefficient(const I& index, const unsigned int column, const C value)
+  {
+    typename CONTAINER::iterator it(CONTAINER::lower_bound(index));
+    if (it == CONTAINER::end() || it->first != index)
+      it = CONTAINER::emplace_hint(it, index, Values());
+    it->second[column] = value;
+  }
+
+  // the values of all K columns at index, with a single lookup;
+  // a new entry is inserted with zeros in all columns
+  Values& values(const I& index)
+  {
+    return CONTAINER::try_emplace(index).first->second;
+  }
+
+  // the given column as an InfiniteVector
+  InfiniteVector<C,I> column(const unsigned int column) const
+  {
+    InfiniteVector<C,I> r;
+    for (const_iterator it(begin()); it != end(); ++it)
+      if (it->second[column] != C(0))
+        r.set_coefficient(it->first, it->second[column]);
+    return r;
+  }
+
+  // column k += alpha[k] * column k of v, for all k
+  void add(const Values& alpha, const InfiniteMultiVector<C,I,K,CONTAINER>& v)
+  {
+    typename CONTAINER::iterator hint(CONTAINER::begin());
+    for (const_iterator it(v.begin()); it != v.end(); ++it)
+    {
+      while (hint != CONTAINER::end() && hint->first < it->first)
+        ++hint;
+      if (hint == CONTAINER::end() || hint->first != it->first)
+        hint = CONTAINER::emplace_hint(hint, it->first, Values());
+      C* y(hint->second.data());
+      const C* x(it->second.data());
+      for (unsigned int k = 0; k < K; k++)
+        y[k] += alpha[k] * x[k];
+    }
+  }
+
+  // *this += alpha*v
+  void add(const C alpha, const InfiniteMultiVector<C,I,K,CONTAINER>& v)
+  {
+    Values a;
+    a.fill(alpha);
+    add(a, v);
+  }
+
+  // the K columnwise inner products
+  Values dot(const InfiniteMultiVector<C,I,K,CONTAINER>& v) const
+  {
+    Values r = {};
+    const_iterator it(begin()), vit(v.begin());
+    while (it != end() && vit != v.end())
+    {
+      if (it->first < vit->first)
+        ++it;
+      else if (vit->first < it->first)
+        ++vit;
+      else
+      {
+        const C* x(it->second.data());
+        const C* y(vit->second.data());
+        for (unsigned int k = 0; k < K; k++)
+          r[k] += x[k] * y[k];
+        ++it;
+        ++vit;
+      }
+    }
+    return r;
+  }
+};
+
+template <class C, class I=int>
+class SparseMatrix
+{
+public:
+  typedef InfiniteVector<C,I> Row;
+  typedef std::map<I,Row> RowContainer;
+
+  void set_entry(const I& row, const I& column, const C value)
+  {
+    _rows[row].set_coefficient(column, value);
+  }
+
+  // y = A x
+  void apply(const InfiniteVector<C,I>& x, InfiniteVector<C,I>& y) const
+  {
+    y.clear();
+    for (typename RowContainer::const_iterator row(_rows.begin()); row != _rows.end(); ++row)
+    {
+      C sum(0);
+      bool nontrivial(false);
+      for (typename Row::const_iterator it(row->second.begin()); it != row->second.end(); ++it)
+      {
+        typename InfiniteVector<C,I>::const_iterator xj(x.find(it->first));
+        if (xj != x.end())
+        {
+          sum += it->second * xj->second;
+          nontrivial = true;
+        }
+      }
+      if (nontrivial)
+        y.set_coefficient(row->first, sum);
+    }
+  }
+
+  // Y = A X for all K columns at once, with one lookup in X per matrix entry
+  // and one lookup in Y per row
+  template <size_t K>
+  void apply(const InfiniteMultiVector<C,I,K>& X, InfiniteMultiVector<C,I,K>& Y) const
+  {
+    Y.clear();
+    for (typename RowContainer::const_iterator row(_rows.begin()); row != _rows.end(); ++row)
+    {
+      typename InfiniteMultiVector<C,I,K>::Values sum = {};
+      bool nontrivial(false);
+      for (typename Row::const_iterator it(row->second.begin()); it != row->second.end(); ++it)
+      {
+        typename InfiniteMultiVector<C,I,K>::const_iterator xj(X.find(it->first));
+        if (xj != X.end())
+        {
+          const C a(it->second);
+          const C* x(xj->second.data());
+          for (unsigned int k = 0; k < K; k++)
+            sum[k] += a * x[k];
+          nontrivial = true;
+        }
+      }
+      if (nontrivial)
+        Y.values(row->first) = sum;
+    }
+  }
+
+private:
+  RowContainer _rows;
+};
+
+// compare the nonzero entries of column k of X with those of x
+template <class C, class I, size_t K>
+bool equal_column(const InfiniteMultiVector<C,I,K>& X, const unsigned int k,
+                  const InfiniteVector<C,I>& x)
+{
+  size_t nonzeros(0);
+  for (typename InfiniteVector<C,I>::const_iterator it(x.begin()); it != x.end(); ++it)
+  {
+    if (it->second == C(0))
+      continue;
+    if (X.get_coefficient(it->first, k) != it->second)
+      return false;
+    nonzeros++;
+  }
+  return (X.column(k).size() == nonzeros);
+}
+
+int main()
+{
+  const size_t K=16;
+  const int N=20000;
+
+  // a banded test matrix
+  SparseMatrix<double,int> A;
+  for (int i=0; i<N; i++)
+  {
+    A.set_entry(i, i, 2.0);
+    if (i>0) A.set_entry(i, i-1, -1.0);
+    if (i+1<N) A.set_entry(i, i+1, -1.0);
+    if (i+50<N) A.set_entry(i, i+50, 0.5);
+  }
+
+  // K right-hand sides on nearly the same index set, stored both as
+  // K separate vectors and as one multi-vector
+  std::vector<InfiniteVector<double,int> > x(K), y(K);
+  InfiniteMultiVector<double,int,K> X, Y;
+  for (unsigned int k=0; k<K; k++)
+    for (int i=0; i<N; i++)
+      if ((i+k)%17 != 0)
+      {
+        const double value=1.0+(i%7)+k;
+        x[k].set_coefficient(i, value);
+        X.set_coefficient(i, k, value);
+        y[k].set_coefficient(i, 0.5*value);
+        Y.set_coefficient(i, k, 0.5*value);
+      }
+  cout << "- number of stored indices: " << K << " separate vectors: ";
+  size_t total=0;
+  for (unsigned int k=0; k<K; k++)
+    total += x[k].size();
+  cout << total << ", one multi-vector: " << X.size() << endl;
+
+  const int repetitions=10;
+
+  // axpy
+  clock_t start=clock();
+  for (int r=0; r<repetitions; r++)
+    for (unsigned int k=0; k<K; k++)
+      y[k].add(0.25, x[k]);
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    Y.add(0.25, X);
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  // inner products
+  std::array<double,K> d1, d2;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    for (unsigned int k=0; k<K; k++)
+      d1[k] = x[k]*y[k];
+  const double dur3=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    d2=X.dot(Y);
+  const double dur4=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  // matrix-vector products
+  std::vector<InfiniteVector<double,int> > z(K);
+  InfiniteMultiVector<double,int,K> Z;
+  start=clock();
+  for (unsigned int k=0; k<K; k++)
+    A.apply(x[k], z[k]);
+  const double dur5=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  A.apply(X, Z);
+  const double dur6=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  bool equal=(d1==d2);
+  for (unsigned int k=0; k<K; k++)
+    equal = equal && equal_column(Y, k, y[k]) && equal_column(Z, k, z[k]);
+  cout << "- multi-vector results equal the results for separate vectors? "
+    << (equal ? "yes" : "no") << endl;
+
+  cout << "\naxpy on " << K << " separate vectors: " << dur1 << "s\n";
+  cout << "axpy on one multi-vector: " << dur2 << "s\n";
+  cout << "inner products of " << K << " separate vectors: " << dur3 << "s\n";
+  cout << "inner products of one multi-vector: " << dur4 << "s\n";
+  cout << "matrix applied to " << K << " separate vectors: " << dur5 << "s\n";
+  cout << "matrix applied to one multi-vector: " << dur6 << "s\n";
+
+  return 0;
+}
@@ -0,0 +1,334 @@
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <ranges>
+#include <iterator>
+#include <utility>
+#include <limits>
+#include <cmath>
+#include <time.h>
+
+/*
+ Many adaptive wavelet algorithms only need a part of a coefficient vector:
+ all coefficients on level j, all indices in a window [a,b), or all entries
+ with modulus above some threshold. So far, such parts were extracted by
+ copying them into a new InfiniteVector.
+
+ In this design test program, we check whether C++20 ranges can do the job
+ lazily, without any copy:
+ 1) index_window(v,a,b) is a std::ranges::subrange of the const_iterators of
+    v, delimited by two calls of lower_bound(). For ordered backends, it can
+    be constructed in O(log N) and costs no memory at all.
+ 2) level_view(v,j) is the index window [(j,-inf),(j+1,-inf)), provided that
+    the comparison of CONTAINER keeps the indices of one level together
+    (which the comparison object announces by a constant level_ordered).
+    Otherwise, e.g., for hashed containers or the Cantor ordering nr(), it
+    falls back to a filtering view.
+ 3) above(tol) is a range adaptor which can be composed with all these views
+    (and with v itself) via operator |, e.g.,
+      for (const auto& entry : level_view(v,j) | above(tol)) ...
+ Since all views are built upon the existing const_iterator, the iterator
+ has to model std::bidirectional_iterator, i.e., it has to be default
+ constructible and assignable.
+ */
+
+using std::cout;
+using std::endl;
+
+// a wavelet index (j,k) with level j and translation k
+class Key
+{
+public:
+  int j, k;
+
+  Key()
+  : j(0), k(0)
+  {
+  }
+
+  Key(int x, int y)
+  : j(x), k(y)
+  {
+  }
+
+  bool operator == (const Key& vgl) const
+  {
+    return (j == vgl.j && k == vgl.k);
+  }
+};
+
+std::ostream& operator << (std::ostream& os, const Key& key)
+{
+  os << '(' << key.j << "," << key.k << ')';
+  return os;
+}
+
+// lexicographical comparison, all indices on one level are consecutive
+struct Key_Compare
+{
+  static constexpr bool level_ordered = true;
+
+  bool operator() (const Key& lhs, const Key& rhs) const
+  {
+    return ((lhs.j < rhs.j) || ((lhs.j == rhs.j) && (lhs.k < rhs.k)));
+  }
+};
+
+// sorting Keys with nr(), the levels are interleaved
+struct Key_Compare2
+{
+  bool operator() (const Key& lhs, const Key& rhs) const
+  {
+    return ((lhs.j+lhs.k)*(lhs.j+lhs.k+1)/2+lhs.j < (rhs.j+rhs.k)*(rhs.j+rhs.k+1)/2+rhs.j);
+  }
+};
+
+struct Key_Hash
+{
+  size_t operator() (const Key& key) const
+  {
+    return std::hash<long>()((long(key.j) << 32) + key.k);
+  }
+};
+
+// forward declaration of InfiniteVector iterators
+template <class C, class I, class CONTAINER> class InfiniteVectorConstIterator;
+
+template <class C, class I=Key, class CONTAINER=std::map<I,C,Key_Compare> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  friend class InfiniteVectorConstIterator<C,I,CONTAINER>;
+  typedef InfiniteVectorConstIterator<C,I,CONTAINER> const_iterator;
+  typedef CONTAINER container_type;
+
+  typedef typename CONTAINER::value_type value_type;
+
+  const_iterator begin() const
+  {
+    return const_iterator(*this, CONTAINER::begin());
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(*this, CONTAINER::end());
+  }
+
+  // first entry with an index not less than the given one (ordered backends only)
+  const_iterator lower_bound(const I& index) const
+  {
+    return const_iterator(*this, CONTAINER::lower_bound(index));
+  }
+
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  void set_coefficient(const I& index, const C value)
+  {
+    CONTAINER::operator [] (index) = value;
+  }
+};
+
+template <class C, class I, class CONTAINER>
+class InfiniteVectorConstIterator
+: protected CONTAINER::const_iterator
+{
+public:
+  typedef typename CONTAINER::const_iterator::iterator_category iterator_category;
+  typedef typename CONTAINER::const_iterator::difference_type difference_type;
+  typedef typename CONTAINER::const_iterator::value_type value_type;
+  typedef typename CONTAINER::const_iterator::pointer pointer;
+  typedef typename CONTAINER::const_iterator::reference reference;
+
+private:
+  // a pointer (instead of a reference), so that iterators are assignable
+  const InfiniteVector<C,I,CONTAINER>* _container;
+
+public:
+  InfiniteVectorConstIterator()
+  : CONTAINER::const_iterator(), _container(nullptr)
+  {
+  }
+
+  InfiniteVectorConstIterator(const InfiniteVector<C,I,CONTAINER>& container,
+                              typename CONTAINER::const_iterator state)
+  : CONTAINER::const_iterator(state), _container(&container)
+  {
+  }
+
+  bool operator == (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+  {
+    return (static_cast<typename CONTAINER::const_iterator>(*this)
+            == static_cast<typename CONTAINER::const_iterator>(it));
+  }
+
+  bool operator != (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+  {
+    return !(*this == it);
+  }
+
+  InfiniteVectorConstIterator<C,I,CONTAINER>& operator ++ ()
+  {
+    CONTAINER::const_iterator::operator ++ ();
+    return *this;
+  }
+
+  InfiniteVectorConstIterator<C,I,CONTAINER> operator ++ (int step)
+  {
+    InfiniteVectorConstIterator<C,I,CONTAINER> r(*this);
+    CONTAINER::const_iterator::operator ++ (step);
+    return r;
+  }
+
+  InfiniteVectorConstIterator<C,I,CONTAINER>& operator -- ()
+  {
+    CONTAINER::const_iterator::operator -- ();
+    return *this;
+  }
+
+  InfiniteVectorConstIterator<C,I,CONTAINER> operator -- (int step)
+  {
+    InfiniteVectorConstIterator<C,I,CONTAINER> r(*this);
+    CONTAINER::const_iterator::operator -- (step);
+    return r;
+  }
+
+  const I& index() const
+  {
+    return (CONTAINER::const_iterator::operator * ()).first;
+  }
+
+  const C& value() const
+  {
+    return (CONTAINER::const_iterator::operator * ()).second;
+  }
+
+  const reference operator * () const
+  {
+    return CONTAINER::const_iterator::operator * ();
+  }
+
+  const pointer operator -> () const
+  {
+    return CONTAINER::const_iterator::operator -> ();
+  }
+};
+
+// does CONTAINER keep the indices of one level together?
+template <class CONTAINER>
+constexpr bool is_level_ordered()
+{
+  if constexpr (requires { CONTAINER::key_compare::level_ordered; })
+    return CONTAINER::key_compare::level_ordered;
+  else
+    return false;
+}
+
+// all entries with indices in [a,b), for ordered backends
+template <class C, class I, class CONTAINER>
+std::ranges::subrange<typename InfiniteVector<C,I,CONTAINER>::const_iterator>
+index_window(const InfiniteVector<C,I,CONTAINER>& v, const I& a, const I& b)
+{
+  return std::ranges::subrange(v.lower_bound(a), v.lower_bound(b));
+}
+
+// all entries on level j
+template <class C, class I, class CONTAINER>
+auto level_view(const InfiniteVector<C,I,CONTAINER>& v, const int j)
+{
+  if constexpr (is_level_ordered<CONTAINER>())
+  {
+    const int kmin(std::numeric_limits<int>::min());
+    return index_window(v, I(j,kmin), I(j+1,kmin));
+  }
+  else
+  {
+    return std::ranges::subrange(v.begin(), v.end())
+      | std::views::filter([j] (const typename InfiniteVector<C,I,CONTAINER>::value_type& entry)
+                           { return entry.first.j == j; });
+  }
+}
+
+// range adaptor for all entries with modulus above tol
+inline auto above(const double tol)
+{
+  return std::views::filter([tol] (const auto& entry) { return fabs(entry.second) > tol; });
+}
+
+int main()
+{
+  static_assert(std::bidirectional_iterator<InfiniteVector<double>::const_iterator>);
+  static_assert(std::ranges::view<decltype(level_view(std::declval<const InfiniteVector<double>&>(), 0))>);
+
+  // a vector of decaying wavelet coefficients on the levels 0,...,J,
+  // stored with three different backends
+  const int J=14;
+  InfiniteVector<double> v;
+  InfiniteVector<double,Key,std::map<Key,double,Key_Compare2> > w;
+  InfiniteVector<double,Key,std::unordered_map<Key,double,Key_Hash> > u;
+  for (int j=0; j<=J; j++)
+    for (int k=0; k<(1<<j); k++)
+    {
+      const double value=pow(2.0, -j)*(1+(k%4));
+      v.set_coefficient(Key(j,k), value);
+      w.set_coefficient(Key(j,k), value);
+      u.set_coefficient(Key(j,k), value);
+    }
+
+  cout << "- the coefficients on level 2:" << endl;
+  for (const auto& entry : level_view(v, 2))
+    cout << "  " << entry.first << ": " << entry.second << endl;
+
+  cout << "- the coefficients in the index window [(3,5),(3,9)):" << endl;
+  for (const auto& entry : index_window(v, Key(3,5), Key(3,9)))
+    cout << "  " << entry.first << ": " << entry.second << endl;
+
+  const double tol=0.01;
+  cout << "- number of coefficients above " << tol << ": "
+    << std::ranges::distance(v | above(tol)) << endl;
+  cout << "- number of coefficients above " << tol << " on level 6: "
+    << std::ranges::distance(level_view(v, 6) | above(tol)) << ", "
+    << std::ranges::distance(level_view(w, 6) | above(tol)) << " (Cantor ordering), "
+    << std::ranges::distance(level_view(u, 6) | above(tol)) << " (hashed)" << endl;
+
+  // compare the costs of the level views for the different backends
+  const int repetitions=20;
+  double sum1=0, sum2=0, sum3=0;
+  clock_t start=clock();
+  for (int r=0; r<repetitions; r++)
+    for (int j=0; j<=J; j++)
+      for (const auto& entry : level_view(v, j))
+        sum1 += entry.second;
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    for (int j=0; j<=J; j++)
+      for (const auto& entry : level_view(w, j))
+        sum2 += entry.second;
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    for (int j=0; j<=J; j++)
+    {
+      InfiniteVector<double> copy;
+      for (const auto& entry : v)
+        if (entry.first.j == j)
+          copy.set_coefficient(entry.first, entry.second);
+      for (const auto& entry : copy)
+        sum3 += entry.second;
+    }
+  const double dur3=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  cout << "- all level sums agree? " << (sum1==sum2 && sum1==sum3 ? "yes" : "no") << endl;
+
+  cout << "\nlevel views via lower_bound (Key_Compare): " << dur1 << "s\n";
+  cout << "level views via filtering (Key_Compare2): " << dur2 << "s\n";
+  cout << "copies of the levels: " << dur3 << "s\n";
+
+  return 0;
+}
@@ -0,0 +1,592 @@
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+/*
+ Relaxation schemes like Gauss-Seidel or Richardson iterations update the
+ coefficients of the current iterate x in place, while walking through its
+ support. With InfiniteVectorConstIterator as the only iterator of
+ InfiniteVector, every such update needs a separate lookup via
+ set_coefficient(), i.e., a second O(log N) search for an entry that the
+ iterator already points to.
+
+ In this design test program, we add a mutable iterator InfiniteVectorIterator
+ (with index() and a writable value()) and use it for in-place sweep kernels:
+ 1) gauss_seidel_sweep() walks through the support of x with a mutable
+    iterator, and in parallel (i.e., without any searching) through the rows
+    of the matrix and through the right-hand side, and overwrites x_i through
+    the iterator position.
+ 2) richardson_sweep() computes the residual r=b-Ax into a workspace vector
+    and merges x+=omega*r in a single pass, updating existing entries through
+    the iterator and inserting new ones with the iterator as a hint.
+ 3) For block sweeps in parallel, BlockColouring splits the support of x into
+    blocks of consecutive entries and colours the blocks such that no two
+    blocks of the same colour are coupled by the matrix. Then
+    multicolour_gauss_seidel_sweep() relaxes all blocks of one colour
+    concurrently, each of them sequentially with a mutable iterator.
+    Since only the values of existing entries are written, the tree
+    structure of CONTAINER is never modified during the parallel phase.
+ */
+
+using std::cout;
+using std::endl;
+
+// forward declaration of InfiniteVector iterators
+template <class C, class I, class CONTAINER> class InfiniteVectorConstIterator;
+template <class C, class I, class CONTAINER> class InfiniteVectorIterator;
+
+template <class C, class I=int, class CONTAINER=std::map<I,C> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  friend class InfiniteVectorConstIterator<C,I,CONTAINER>;
+  friend class InfiniteVectorIterator<C,I,CONTAINER>;
+  typedef InfiniteVectorConstIterator<C,I,CONTAINER> const_iterator;
+  typedef InfiniteVectorIterator<C,I,CONTAINER> iterator;
+
+  typedef typename CONTAINER::value_type value_type;
+
+  InfiniteVector()
+  : CONTAINER()
+  {
+  }
+
+  const_iterator begin() const
+  {
+    return const_iterator(*this, CONTAINER::begin());
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(*this, CONTAINER::end());
+  }
+
+  iterator begin()
+  {
+    return iterator(*this, CONTAINER::begin());
+  }
+
+  iterator end()
+  {
+    return iterator(*this, CONTAINER::end());
+  }
+
+  // first entry with an index not less than the given one
+  const_iterator lower_bound(const I& index) const
+  {
+    return const_iterator(*this, CONTAINER::lower_bound(index));
+  }
+
+  iterator lower_bound(const I& index)
+  {
+    return iterator(*this, CONTAINER::lower_bound(index));
+  }
+
+  // insert a new entry before the position hint, returns its position
+  iterator insert(const iterator& hint, const I& index, const C value)
+  {
+    return iterator(*this, CONTAINER::emplace_hint(hint, index, value));
+  }
+
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  C get_coefficient(const I& index) const
+  {
+    typename CONTAINER::const_iterator it(CONTAINER::find(index));
+    return (it == CONTAINER::end() ? C(0) : it->second);
+  }
+
+  void set_coefficient(const I& index, const C value)
+  {
+    CONTAINER::operator [] (index) = value;
+  }
+
+  void add_coefficient(const I& index, const C increment)
+  {
+    CONTAINER::operator [] (index) += increment;
+  }
+
+  void clear()
+  {
+    CONTAINER::clear();
+  }
+
+  double l2_norm() const
+  {
+    double r(0);
+    for (typename CONTAINER::const_iterator it(CONTAINER::begin()); it != CONTAINER::end(); ++it)
+      r += it->second * it->second;
+    return sqrt(r);
+  }
+};
+
+template <class C, class I, class CONTAINER>
+class InfiniteVectorConstIterator
+: protected CONTAINER::const_iterator
+{
+public:
+  typedef typename CONTAINER::const_iterator::iterator_category iterator_category;
+  typedef typename CONTAINER::const_iterator::difference_type difference_type;
+  typedef typename CONTAINER::const_iterator::value_type value_type;
+  typedef typename CONTAINER::const_iterator::pointer pointer;
+  typedef typename CONTAINER::const_iterator::reference reference;
+
+private:
+  const InfiniteVector<C,I,CONTAINER>* _container; // a pointer, so that iterators are assignable
+
+public:
+  InfiniteVectorConstIterator(const InfiniteVector<C,I,CONTAINER>& container,
+                              typename CONTAINER::const_iterator state)
+  : CONTAINER::const_iterator(state), _container(&container)
+  {
+  }
+
+  // every mutable iterator can be used as a const iterator
+  InfiniteVectorConstIterator(const InfiniteVectorIterator<C,I,CONTAINER>& it)
+  : CONTAINER::const_iterator(static_cast<const typename CONTAINER::iterator&>(it)),
+    _container(it._container)
+  {
+  }
+
+  bool operator == (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+  {
+    return (static_cast<typename CONTAINER::const_iterator>(*this)
+            == static_cast<typename CONTAINER::const_iterator>(it));
+  }
+
+  bool operator != (const InfiniteVectorConstIterator<C,I,CONTAINER>& it) const
+  {
+    return !(*this == it);
+  }
+
+  InfiniteVectorConstIterator<C,I,CONTAINER>& operator ++ ()
+  {
+    CONTAINER::const_iterator::operator ++ ();
+    return *this;
+  }
+
+  const I& index() const
+  {
+    return (CONTAINER::const_iterator::operator * ()).first;
+  }
+
+  const C& value() const
+  {
+    return (CONTAINER::const_iterator::operator * ()).second;
+  }
+
+  const reference operator * () const
+  {
+    return CONTAINER::const_iterator::operator * ();
+  }
+};
+
+/*
+ The mutable counterpart of InfiniteVectorConstIterator: the index of an
+ entry is still read-only, but its value can be modified in place.
+ */
+template <class C, class I, class CONTAINER>
+class InfiniteVectorIterator
+: protected CONTAINER::iterator
+{
+public:
+  typedef typename CONTAINER::iterator::iterator_category iterator_category;
+  typedef typename CONTAINER::iterator::difference_type difference_type;
+  typedef typename CONTAINER::iterator::value_type value_type;
+  typedef typename CONTAINER::iterator::pointer pointer;
+  typedef typename CONTAINER::iterator::reference reference;
+
+  friend class InfiniteVector<C,I,CONTAINER>;
+  friend class InfiniteVectorConstIterator<C,I,CONTAINER>;
+
+private:
+  InfiniteVector<C,I,CONTAINER>* _container;
+
+public:
+  InfiniteVectorIterator(InfiniteVector<C,I,CONTAINER>& container,
+                         typename CONTAINER::iterator state)
+  : CONTAINER::iterator(state), _container(&container)
+  {
+  }
+
+  bool operator == (const InfiniteVectorIterator<C,I,CONTAINER>& it) const
+  {
+    return (static_cast<typename CONTAINER::iterator>(*this)
+            == static_cast<typename CONTAINER::iterator>(it));
+  }
+
+  bool operator != (const InfiniteVectorIterator<C,I,CONTAINER>& it) const
+  {
+    return !(*this == it);
+  }
+
+  InfiniteVectorIterator<C,I,CONTAINER>& operator ++ ()
+  {
+    CONTAINER::iterator::operator ++ ();
+    return *this;
+  }
+
+  const I& index() const
+  {
+    return (CONTAINER::iterator::operator * ()).first;
+  }
+
+  C& value() const
+  {
+    return (CONTAINER::iterator::operator * ()).second;
+  }
+
+  reference operator * () const
+  {
+    return CONTAINER::iterator::operator * ();
+  }
+};
+
+template <class C, class I=int>
+class SparseMatrix
+{
+public:
+  typedef InfiniteVector<C,I> Row;
+  typedef std::map<I,Row> RowContainer;
+
+  const RowContainer& rows() const
+  {
+    return _rows;
+  }
+
+  void set_entry(const I& row, const I& column, const C value)
+  {
+    _rows[row].set_coefficient(column, value);
+  }
+
+  // y = A x
+  void apply(const InfiniteVector<C,I>& x, InfiniteVector<C,I>& y) const
+  {
+    y.clear();
+    for (typename InfiniteVector<C,I>::const_iterator it(x.begin()); it != x.end(); ++it)
+    {
+      typename RowContainer::const_iterator row(_rows.find(it.index()));
+      if (row == _rows.end())
+        continue;
+      // A is symmetric in our tests, so that the rows can be used as columns
+      for (typename Row::const_iterator rit(row->second.begin()); rit != row->second.end(); ++rit)
+        y.add_coefficient(rit.index(), rit.value() * it.value());
+    }
+  }
+
+private:
+  RowContainer _rows;
+};
+
+/*
+ Relax the entry x_i at the position it, i.e., solve the i-th equation for x_i,
+ using the row of A and the right-hand side bi.
+ */
+template <class C, class I>
+void relax_entry(const typename SparseMatrix<C,I>::Row& row, const C bi,
+                 const InfiniteVector<C,I>& x, const typename InfiniteVector<C,I>::iterator& it)
+{
+  C sum(bi), diagonal(0);
+  bool has_diagonal(false);
+  for (typename SparseMatrix<C,I>::Row::const_iterator rit(row.begin()); rit != row.end(); ++rit)
+  {
+    if (rit.index() == it.index())
+    {
+      diagonal = rit.value();
+      has_diagonal = true;
+    }
+    else
+      sum -= rit.value() * x.get_coefficient(rit.index());
+  }
+  assert(has_diagonal); // the row has to contain the diagonal entry a_ii
+  it.value() = sum/diagonal;
+}
+
+/*
+ Relax all entries in [first,last) in order, walking through the rows of A and
+ the entries of b in parallel.
+ */
+template <class C, class I>
+void gauss_seidel_sweep(const SparseMatrix<C,I>& A, const InfiniteVector<C,I>& b,
+                        InfiniteVector<C,I>& x,
+                        typename InfiniteVector<C,I>::iterator it,
+                        const typename InfiniteVector<C,I>::iterator& last)
+{
+  if (it == last)
+    return;
+  typename SparseMatrix<C,I>::RowContainer::const_iterator row(A.rows().lower_bound(it.index()));
+  typename InfiniteVector<C,I>::const_iterator bit(b.lower_bound(it.index()));
+  for (; it != last; ++it)
+  {
+    for (; row != A.rows().end() && row->first < it.index(); ++row);
+    for (; bit != b.end() && bit.index() < it.index(); ++bit);
+    if (row == A.rows().end() || row->first != it.index())
+      continue;
+    relax_entry<C,I>(row->second, (bit != b.end() && bit.index() == it.index() ? bit.value() : C(0)),
+                     x, it);
+  }
+}
+
+// one Gauss-Seidel sweep over the whole support of x
+template <class C, class I>
+void gauss_seidel_sweep(const SparseMatrix<C,I>& A, const InfiniteVector<C,I>& b,
+                        InfiniteVector<C,I>& x)
+{
+  gauss_seidel_sweep(A, b, x, x.begin(), x.end());
+}
+
+// the same sweep, but with one lookup in A, b and x per entry, as done so far
+template <class C, class I>
+void gauss_seidel_sweep_with_lookups(const SparseMatrix<C,I>& A, const InfiniteVector<C,I>& b,
+                                     InfiniteVector<C,I>& x)
+{
+  std::vector<I> support;
+  for (typename InfiniteVector<C,I>::const_iterator it(x.begin()); it != x.end(); ++it)
+    support.push_back(it.index());
+  for (size_t k = 0; k < support.size(); k++)
+  {
+    typename SparseMatrix<C,I>::RowContainer::const_iterator row(A.rows().find(support[k]));
+    if (row == A.rows().end())
+      continue;
+    C sum(b.get_coefficient(support[k])), diagonal(0);
+    for (typename SparseMatrix<C,I>::Row::const_iterator rit(row->second.begin());
+         rit != row->second.end(); ++rit)
+    {
+      if (rit.index() == support[k])
+        diagonal = rit.value();
+      else
+        sum -= rit.value() * x.get_coefficient(rit.index());
+    }
+    x.set_coefficient(support[k], sum/diagonal);
+  }
+}
+
+/*
+ One Richardson step x += omega*(b-Ax); the residual is stored in r.
+ Existing entries of x are updated through the iterator position,
+ new entries are inserted in front of it.
+ */
+template <class C, class I>
+void richardson_sweep(const SparseMatrix<C,I>& A, const InfiniteVector<C,I>& b,
+                      InfiniteVector<C,I>& x, const C omega, InfiniteVector<C,I>& r)
+{
+  A.apply(x, r);
+  typename InfiniteVector<C,I>::const_iterator bit(b.begin());
+  typename InfiniteVector<C,I>::iterator rit(r.begin());
+  for (; bit != b.end(); ++bit)
+  {
+    for (; rit != r.end() && rit.index() < bit.index(); ++rit)
+      rit.value() = -rit.value();
+    if (rit != r.end() && rit.index() == bit.index())
+    {
+      rit.value() = bit.value() - rit.value();
+      ++rit;
+    }
+    else
+      r.insert(rit, bit.index(), bit.value());
+  }
+  for (; rit != r.end(); ++rit)
+    rit.value() = -rit.value();
+
+  typename InfiniteVector<C,I>::iterator it(x.begin());
+  for (typename InfiniteVector<C,I>::const_iterator rit(r.begin()); rit != r.end(); ++rit)
+  {
+    for (; it != x.end() && it.index() < rit.index(); ++it);
+    if (it != x.end() && it.index() == rit.index())
+      it.value() += omega * rit.value();
+    else
+      x.insert(it, rit.index(), omega * rit.value());
+  }
+}
+
+/*
+ A colouring of the support of x, split into blocks of up to blocksize
+ consecutive entries, such that blocks of the same colour are not coupled by A.
+ The block boundaries are iterators into x, so the colouring has to be set up
+ again if the support of x changes.
+ */
+template <class C, class I=int>
+class BlockColouring
+{
+public:
+  typedef typename InfiniteVector<C,I>::iterator iterator;
+
+  struct Block
+  {
+    iterator first, last;
+  };
+
+  BlockColouring(const SparseMatrix<C,I>& A, InfiniteVector<C,I>& x, const size_t blocksize)
+  {
+    assert(blocksize > 0);
+
+    // split the support into blocks
+    std::vector<Block> blocks;
+    std::map<I,size_t> block_of;
+    for (iterator it(x.begin()); it != x.end();)
+    {
+      Block block = { it, it };
+      for (size_t k = 0; k < blocksize && block.last != x.end(); k++, ++block.last)
+        block_of[block.last.index()] = blocks.size();
+      it = block.last;
+      blocks.push_back(block);
+    }
+
+    // greedy colouring of the block graph
+    std::vector<size_t> colour(blocks.size());
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+      std::set<size_t> neighbour_colours;
+      for (iterator it(blocks[b].first); it != blocks[b].last; ++it)
+      {
+        typename SparseMatrix<C,I>::RowContainer::const_iterator row(A.rows().find(it.index()));
+        if (row == A.rows().end())
+          continue;
+        for (typename SparseMatrix<C,I>::Row::const_iterator rit(row->second.begin());
+             rit != row->second.end(); ++rit)
+        {
+          typename std::map<I,size_t>::const_iterator nb(block_of.find(rit.index()));
+          if (nb != block_of.end() && nb->second < b)
+            neighbour_colours.insert(colour[nb->second]);
+        }
+      }
+      for (colour[b] = 0; neighbour_colours.count(colour[b]); colour[b]++);
+      if (colour[b] >= _colours.size())
+        _colours.resize(colour[b]+1);
+      _colours[colour[b]].push_back(blocks[b]);
+    }
+  }
+
+  size_t colours() const
+  {
+    return _colours.size();
+  }
+
+  const std::vector<Block>& blocks(const size_t colour) const
+  {
+    return _colours[colour];
+  }
+
+private:
+  std::vector<std::vector<Block> > _colours;
+};
+
+/*
+ One block Gauss-Seidel sweep, relaxing the blocks of each colour concurrently.
+ */
+template <class C, class I>
+void multicolour_gauss_seidel_sweep(const SparseMatrix<C,I>& A, const InfiniteVector<C,I>& b,
+                                    InfiniteVector<C,I>& x,
+                                    const BlockColouring<C,I>& colouring,
+                                    const unsigned int nthreads)
+{
+  for (size_t c = 0; c < colouring.colours(); c++)
+  {
+    const std::vector<typename BlockColouring<C,I>::Block>& blocks(colouring.blocks(c));
+    auto relax_blocks = [&] (const unsigned int t)
+    {
+      for (size_t k = t; k < blocks.size(); k += nthreads)
+        gauss_seidel_sweep(A, b, x, blocks[k].first, blocks[k].last);
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < nthreads; t++)
+      threads.emplace_back(relax_blocks, t);
+    for (unsigned int t = 0; t < nthreads; t++)
+      threads[t].join();
+  }
+}
+
+template <class C, class I>
+double residual_norm(const SparseMatrix<C,I>& A, const InfiniteVector<C,I>& b,
+                     const InfiniteVector<C,I>& x)
+{
+  InfiniteVector<C,I> r;
+  A.apply(x, r);
+  for (typename InfiniteVector<C,I>::const_iterator it(b.begin()); it != b.end(); ++it)
+    r.add_coefficient(it.index(), -it.value());
+  return r.l2_norm();
+}
+
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+  // five-point stencil of the 2D Laplacian (plus a shift) on an n x n grid,
+  // the grid point (p,q) having the index p*n+q
+  const int n=100;
+  SparseMatrix<double,int> A;
+  InfiniteVector<double,int> b, x0;
+  for (int p=0; p<n; p++)
+    for (int q=0; q<n; q++)
+    {
+      const int i=p*n+q;
+      A.set_entry(i, i, 4.5);
+      if (p>0) A.set_entry(i, i-n, -1.0);
+      if (p+1<n) A.set_entry(i, i+n, -1.0);
+      if (q>0) A.set_entry(i, i-1, -1.0);
+      if (q+1<n) A.set_entry(i, i+1, -1.0);
+      b.set_coefficient(i, ((p*q)%7==0 ? 1.0 : 0.0));
+      x0.set_coefficient(i, 0.0);
+    }
+
+  const int sweeps=20;
+  cout << "- initial residual: " << residual_norm(A, b, x0) << endl;
+
+  InfiniteVector<double,int> x(x0);
+  std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+  for (int k=0; k<sweeps; k++)
+    gauss_seidel_sweep_with_lookups(A, b, x);
+  const double dur1=seconds_since(start);
+  cout << "- residual after " << sweeps << " Gauss-Seidel sweeps with lookups: "
+    << residual_norm(A, b, x) << endl;
+
+  InfiniteVector<double,int> y(x0);
+  start=std::chrono::steady_clock::now();
+  for (int k=0; k<sweeps; k++)
+    gauss_seidel_sweep(A, b, y);
+  const double dur2=seconds_since(start);
+  cout << "- residual after " << sweeps << " Gauss-Seidel sweeps with a mutable iterator: "
+    << residual_norm(A, b, y) << endl;
+
+  InfiniteVector<double,int> z, r;
+  start=std::chrono::steady_clock::now();
+  for (int k=0; k<sweeps; k++)
+    richardson_sweep(A, b, z, 0.2, r);
+  const double dur3=seconds_since(start);
+  cout << "- residual after " << sweeps << " Richardson sweeps (starting with a zero vector): "
+    << residual_norm(A, b, z) << endl;
+
+  const unsigned int nthreads=std::max(2u, std::thread::hardware_concurrency());
+  InfiniteVector<double,int> w(x0);
+  start=std::chrono::steady_clock::now();
+  BlockColouring<double,int> colouring(A, w, 4*n);
+  const double dur4=seconds_since(start);
+  start=std::chrono::steady_clock::now();
+  for (int k=0; k<sweeps; k++)
+    multicolour_gauss_seidel_sweep(A, b, w, colouring, nthreads);
+  const double dur5=seconds_since(start);
+  cout << "- residual after " << sweeps << " multicolour block Gauss-Seidel sweeps ("
+    << colouring.colours() << " colours, " << nthreads << " threads): "
+    << residual_norm(A, b, w) << endl;
+
+  cout << "\nGauss-Seidel with lookups: " << dur1 << "s\n";
+  cout << "Gauss-Seidel with a mutable iterator: " << dur2 << "s\n";
+  cout << "Richardson with a mutable iterator: " << dur3 << "s\n";
+  cout << "setup of the block colouring: " << dur4 << "s\n";
+  cout << "multicolour block Gauss-Seidel: " << dur5 << "s\n";
+
+  return 0;
+}
@@ -0,0 +1,507 @@
+#include <iostream>
+#include <map>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+
+/*
+ Least-squares and Galerkin-Petrov solvers need the application of the
+ transposed operator A^T v as often as the application A v itself. Storing a
+ second, explicitly transposed copy of every sparse matrix doubles the memory
+ consumption, and the copy has to be kept in sync with the original whenever
+ an entry changes.
+
+ In this design test program, we work out a minimal row-oriented sparse matrix
+ class SparseMatrix on top of InfiniteVector (every row is an InfiniteVector,
+ and the rows themselves are stored in a std::map) and check two ways to apply
+ A^T without materializing the transpose:
+ 1) apply_transposed() walks the existing row storage and scatters
+    y_j += a_ij * x_i into an accumulator. The rows are split into contiguous
+    blocks, one per thread, and every thread scatters into its own accumulator,
+    so that no synchronization is needed while scattering. The per-thread
+    accumulators are summed up afterwards.
+ 2) Optionally, a transposed index can be built lazily, see
+    use_transposed_index(). For each column, it stores the row indices and
+    pointers to the corresponding matrix entries in the row storage (the
+    values themselves are not duplicated). Since std::map never moves its
+    nodes, these pointers stay valid, and set_entry() updates the index
+    incrementally, so that it is always consistent with the row storage.
+    With the index, A^T x can be computed column by column as a gather
+    operation, the columns again being split into one block per thread.
+    The index is not built by default, so memory is only spent when the
+    application asks for it.
+ */
+
+using std::cout;
+using std::endl;
+
+template <class C, class I=int, class CONTAINER=std::map<I,C> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  typedef typename CONTAINER::const_iterator const_iterator;
+  typedef typename CONTAINER::value_type value_type;
+
+  InfiniteVector()
+  : CONTAINER()
+  {
+  }
+
+  const_iterator begin() const
+  {
+    return CONTAINER::begin();
+  }
+
+  const_iterator end() const
+  {
+    return CONTAINER::end();
+  }
+
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  void clear()
+  {
+    CONTAINER::clear();
+  }
+
+  C get_coefficient(const I& index) const
+  {
+    const_iterator it(CONTAINER::find(index));
+    return (it == CONTAINER::end() ? C(0) : it->second);
+  }
+
+  // returns a pointer to the stored coefficient, or nullptr if it is zero
+  const C* find_coefficient(const I& index) const
+  {
+    const_iterator it(CONTAINER::find(index));
+    return (it == CONTAINER::end() ? nullptr : &it->second);
+  }
+
+  // sets a coefficient, a zero value removes the entry;
+  // returns a pointer to the stored coefficient (nullptr if it was removed)
+  const C* set_coefficient(const I& index, const C value)
+  {
+    if (value == C(0))
+    {
+      CONTAINER::erase(index);
+      return nullptr;
+    }
+
+    C& entry(CONTAINER::operator [] (index));
+    entry = value;
+    return &entry;
+  }
+
+  void add_coefficient(const I& index, const C increment)
+  {
+    CONTAINER::operator [] (index) += increment;
+  }
+
+  // *this += v, exploiting that both supports are sorted
+  void add(const InfiniteVector<C,I,CONTAINER>& v)
+  {
+    typename CONTAINER::iterator hint(CONTAINER::begin());
+    for (const_iterator it(v.begin()); it != v.end(); ++it)
+    {
+      while (hint != CONTAINER::end() && hint->first < it->first)
+        ++hint;
+      if (hint != CONTAINER::end() && hint->first == it->first)
+        hint->second += it->second;
+      else
+        hint = CONTAINER::emplace_hint(hint, it->first, it->second);
+    }
+  }
+
+  bool operator == (const InfiniteVector<C,I,CONTAINER>& v) const
+  {
+    return (size()==v.size()) && std::equal(begin(), end(), v.begin());
+  }
+};
+
+template<class C, class I, class CONTAINER>
+std::ostream& operator << (std::ostream& os, const InfiniteVector<C,I,CONTAINER>& v)
+{
+  if (v.begin() == v.end())
+  {
+    os << "0" << std::endl;
+  }
+  else
+  {
+    for (typename InfiniteVector<C,I,CONTAINER>::const_iterator it(v.begin());
+         it != v.end(); ++it)
+    {
+      os << it->first << ": " << it->second << std::endl;
+    }
+  }
+
+  return os;
+}
+
+template <class C, class I=int>
+class SparseMatrix
+{
+public:
+  typedef InfiniteVector<C,I> Row;
+  typedef std::map<I,Row> RowContainer;
+
+  // column j of the transposed index: pairs (i, &a_ij), sorted by i
+  typedef std::vector<std::pair<I,const C*> > TransposedColumn;
+  typedef std::map<I,TransposedColumn> TransposedIndex;
+
+  SparseMatrix()
+  : _rows(), _use_transposed_index(false), _transposed()
+  {
+  }
+
+  // copying the matrix must not copy the pointers into the source
+  SparseMatrix(const SparseMatrix<C,I>& M)
+  : _rows(M._rows), _use_transposed_index(M._use_transposed_index), _transposed()
+  {
+  }
+
+  SparseMatrix<C,I>& operator = (const SparseMatrix<C,I>& M)
+  {
+    _rows = M._rows;
+    _use_transposed_index = M._use_transposed_index;
+    _transposed.reset();
+    return *this;
+  }
+
+  const RowContainer& rows() const
+  {
+    return _rows;
+  }
+
+  C get_entry(const I& row, const I& column) const
+  {
+    typename RowContainer::const_iterator it(_rows.find(row));
+    return (it == _rows.end() ? C(0) : it->second.get_coefficient(column));
+  }
+
+  void set_entry(const I& row, const I& column, const C value)
+  {
+    const C* entry(nullptr);
+    typename RowContainer::iterator it(_rows.find(row));
+    if (it == _rows.end())
+    {
+      if (value == C(0))
+        return;
+      entry = _rows[row].set_coefficient(column, value);
+    }
+    else
+    {
+      entry = it->second.set_coefficient(column, value);
+      if (it->second.size() == 0)
+        _rows.erase(it);
+    }
+
+    if (_transposed)
+      update_transposed_index(row, column, entry);
+  }
+
+  // y = A x
+  void apply(const InfiniteVector<C,I>& x, InfiniteVector<C,I>& y) const
+  {
+    y.clear();
+    for (typename RowContainer::const_iterator row(_rows.begin());
+         row != _rows.end(); ++row)
+    {
+      C sum(0);
+      for (typename Row::const_iterator it(row->second.begin());
+           it != row->second.end(); ++it)
+      {
+        const C* xj(x.find_coefficient(it->first));
+        if (xj)
+          sum += it->second * *xj;
+      }
+      if (sum != C(0))
+        y.set_coefficient(row->first, sum);
+    }
+  }
+
+  // y = A^T x, computed from the row storage (scatter with one accumulator
+  // per thread) or from the transposed index (gather, one block of columns
+  // per thread), if that is enabled
+  void apply_transposed(const InfiniteVector<C,I>& x, InfiniteVector<C,I>& y,
+                        const unsigned int nthreads = 1) const
+  {
+    if (_use_transposed_index)
+      apply_transposed_gather(x, y, nthreads);
+    else
+      apply_transposed_scatter(x, y, nthreads);
+  }
+
+  // enable or disable the lazily built transposed index;
+  // disabling it releases its memory
+  void use_transposed_index(const bool enable)
+  {
+    _use_transposed_index = enable;
+    if (!enable)
+      _transposed.reset();
+  }
+
+  bool has_transposed_index() const
+  {
+    return bool(_transposed);
+  }
+
+private:
+  void apply_transposed_scatter(const InfiniteVector<C,I>& x, InfiniteVector<C,I>& y,
+                                const unsigned int nthreads) const
+  {
+    y.clear();
+
+    // split the rows into nthreads contiguous blocks
+    const size_t nblocks(std::max(1u, std::min<unsigned int>(nthreads, _rows.size())));
+    std::vector<typename RowContainer::const_iterator> bounds(nblocks+1, _rows.end());
+    bounds[0] = _rows.begin();
+    for (size_t b = 1; b < nblocks; b++)
+      bounds[b] = std::next(bounds[b-1], _rows.size()/nblocks);
+
+    std::vector<InfiniteVector<C,I> > accumulators(nblocks);
+
+    auto scatter = [&] (const size_t b)
+    {
+      InfiniteVector<C,I>& acc(accumulators[b]);
+      for (typename RowContainer::const_iterator row(bounds[b]);
+           row != bounds[b+1]; ++row)
+      {
+        const C* xi(x.find_coefficient(row->first));
+        if (!xi)
+          continue;
+        for (typename Row::const_iterator it(row->second.begin());
+             it != row->second.end(); ++it)
+          acc.add_coefficient(it->first, it->second * *xi);
+      }
+    };
+
+    if (nblocks == 1)
+    {
+      scatter(0);
+    }
+    else
+    {
+      std::vector<std::thread> threads;
+      for (size_t b = 0; b < nblocks; b++)
+        threads.emplace_back(scatter, b);
+      for (size_t b = 0; b < nblocks; b++)
+        threads[b].join();
+    }
+
+    // reduce the per-thread accumulators
+    for (size_t b = 0; b < nblocks; b++)
+      y.add(accumulators[b]);
+    remove_zeros(y);
+  }
+
+  void apply_transposed_gather(const InfiniteVector<C,I>& x, InfiniteVector<C,I>& y,
+                               const unsigned int nthreads) const
+  {
+    // the index is built before any thread starts
+    if (!_transposed)
+      build_transposed_index();
+
+    // split the columns into nthreads contiguous blocks
+    const size_t nblocks(std::max(1u, std::min<unsigned int>(nthreads, _transposed->size())));
+    std::vector<typename TransposedIndex::const_iterator> bounds(nblocks+1, _transposed->end());
+    bounds[0] = _transposed->begin();
+    for (size_t b = 1; b < nblocks; b++)
+      bounds[b] = std::next(bounds[b-1], _transposed->size()/nblocks);
+
+    // the nonzero entries of y in each block, in ascending order
+    std::vector<std::vector<std::pair<I,C> > > results(nblocks);
+
+    auto gather = [&] (const size_t b)
+    {
+      for (typename TransposedIndex::const_iterator col(bounds[b]); col != bounds[b+1]; ++col)
+      {
+        C sum(0);
+        for (typename TransposedColumn::const_iterator it(col->second.begin());
+             it != col->second.end(); ++it)
+        {
+          const C* xi(x.find_coefficient(it->first));
+          if (xi)
+            sum += *(it->second) * *xi;
+        }
+        if (sum != C(0))
+          results[b].push_back(std::make_pair(col->first, sum));
+      }
+    };
+
+    if (nblocks == 1)
+    {
+      gather(0);
+    }
+    else
+    {
+      std::vector<std::thread> threads;
+      for (size_t b = 0; b < nblocks; b++)
+        threads.emplace_back(gather, b);
+      for (size_t b = 0; b < nblocks; b++)
+        threads[b].join();
+    }
+
+    y.clear();
+    for (size_t b = 0; b < nblocks; b++)
+      for (size_t i = 0; i < results[b].size(); i++)
+        y.set_coefficient(results[b][i].first, results[b][i].second);
+  }
+
+  void build_transposed_index() const
+  {
+    _transposed.reset(new TransposedIndex());
+    // walking the rows in ascending order keeps every column sorted
+    for (typename RowContainer::const_iterator row(_rows.begin());
+         row != _rows.end(); ++row)
+      for (typename Row::const_iterator it(row->second.begin());
+           it != row->second.end(); ++it)
+        (*_transposed)[it->first].push_back(std::make_pair(row->first, &it->second));
+  }
+
+  // keep the transposed index consistent after a_{row,column} has changed,
+  // entry being nullptr if the entry has been removed
+  void update_transposed_index(const I& row, const I& column, const C* entry)
+  {
+    TransposedColumn& col((*_transposed)[column]);
+    typename TransposedColumn::iterator it
+      (std::lower_bound(col.begin(), col.end(), row,
+                        [] (const std::pair<I,const C*>& p, const I& i) { return p.first < i; }));
+    const bool found(it != col.end() && it->first == row);
+    if (entry)
+    {
+      if (found)
+        it->second = entry;
+      else
+        col.insert(it, std::make_pair(row, entry));
+    }
+    else
+    {
+      if (found)
+        col.erase(it);
+      if (col.empty())
+        _transposed->erase(column);
+    }
+  }
+
+  static void remove_zeros(InfiniteVector<C,I>& y)
+  {
+    std::vector<I> zeros;
+    for (typename InfiniteVector<C,I>::const_iterator it(y.begin()); it != y.end(); ++it)
+      if (it->second == C(0))
+        zeros.push_back(it->first);
+    for (size_t k = 0; k < zeros.size(); k++)
+      y.set_coefficient(zeros[k], C(0));
+  }
+
+  RowContainer _rows;
+  bool _use_transposed_index;
+  mutable std::unique_ptr<TransposedIndex> _transposed;
+};
+
+// explicitly transposed copy, as used so far
+template <class C, class I>
+SparseMatrix<C,I> transpose(const SparseMatrix<C,I>& A)
+{
+  SparseMatrix<C,I> AT;
+  for (typename SparseMatrix<C,I>::RowContainer::const_iterator row(A.rows().begin());
+       row != A.rows().end(); ++row)
+    for (typename SparseMatrix<C,I>::Row::const_iterator it(row->second.begin());
+         it != row->second.end(); ++it)
+      AT.set_entry(it->first, row->first, it->second);
+  return AT;
+}
+
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+  // a nonsymmetric banded test matrix with a few long-range couplings;
+  // all entries are small dyadic numbers, so that the results do not depend
+  // on the summation order and can be compared exactly
+  const int N=20000;
+  SparseMatrix<double,int> A;
+  for (int i=0; i<N; i++)
+  {
+    A.set_entry(i, i, 4.0);
+    if (i+1<N) A.set_entry(i, i+1, -1.0);
+    if (i>0) A.set_entry(i, i-1, -0.5);
+    if (i+97<N) A.set_entry(i, i+97, 0.25);
+    A.set_entry(i, (7*i)%N, 0.125);
+  }
+
+  InfiniteVector<double,int> x;
+  for (int i=0; i<N; i+=3)
+    x.set_coefficient(i, 1.0 + (i%5));
+
+  InfiniteVector<double,int> y1, y2, y3, y4, y5;
+
+  // the old way: materialize A^T and apply it
+  std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+  SparseMatrix<double,int> AT(transpose(A));
+  const double dur_copy=seconds_since(start);
+  start=std::chrono::steady_clock::now();
+  AT.apply(x, y1);
+  const double dur1=seconds_since(start);
+
+  // scatter from the row storage, single-threaded and multi-threaded
+  start=std::chrono::steady_clock::now();
+  A.apply_transposed(x, y2);
+  const double dur2=seconds_since(start);
+
+  const unsigned int nthreads=std::max(2u, std::thread::hardware_concurrency());
+  start=std::chrono::steady_clock::now();
+  A.apply_transposed(x, y3, nthreads);
+  const double dur3=seconds_since(start);
+
+  // gather via the lazily built transposed index
+  A.use_transposed_index(true);
+  cout << "- transposed index built before first use? "
+    << (A.has_transposed_index() ? "yes" : "no") << endl;
+  start=std::chrono::steady_clock::now();
+  A.apply_transposed(x, y4);
+  const double dur4=seconds_since(start);
+  start=std::chrono::steady_clock::now();
+  A.apply_transposed(x, y5, nthreads);
+  const double dur5=seconds_since(start);
+  cout << "- transposed index built after first use? "
+    << (A.has_transposed_index() ? "yes" : "no") << endl;
+
+  cout << "- A^T x via scatter equals A^T x via transposed copy? "
+    << (y1==y2 ? "yes" : "no") << endl;
+  cout << "- A^T x via " << nthreads << " threads equals A^T x via transposed copy? "
+    << (y1==y3 ? "yes" : "no") << endl;
+  cout << "- A^T x via transposed index equals A^T x via transposed copy? "
+    << (y1==y4 ? "yes" : "no") << endl;
+  cout << "- A^T x via transposed index and " << nthreads << " threads equals A^T x via transposed copy? "
+    << (y1==y5 ? "yes" : "no") << endl;
+
+  // modify A and check that the transposed index has been kept consistent
+  A.set_entry(5, 12345, 2.0); // new entry
+  A.set_entry(9, 10, 0.0);    // removed entry
+  A.set_entry(0, 0, 8.0);     // modified entry
+  for (int i=0; i<N; i+=3)
+    x.set_coefficient(i+1, 1.0);
+  AT=transpose(A);
+  AT.apply(x, y1);
+  A.apply_transposed(x, y4);
+  cout << "- after modifying A, the transposed index is still consistent? "
+    << (y1==y4 ? "yes" : "no") << endl;
+
+  cout << "\ncreating the transposed copy: " << dur_copy << "s\n";
+  cout << "applying the transposed copy: " << dur1 << "s\n";
+  cout << "scatter from the row storage, 1 thread: " << dur2 << "s\n";
+  cout << "scatter from the row storage, " << nthreads << " threads: " << dur3 << "s\n";
+  cout << "gather via the transposed index (including its construction): " << dur4 << "s\n";
+  cout << "gather via the transposed index, " << nthreads << " threads: " << dur5 << "s\n";
+
+  return 0;
+}
@@ -0,0 +1,354 @@
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <future>
+#include <numeric>
+#include <iterator>
+#include <type_traits>
+#include <algorithm>
+
+/*
+ In order to traverse an InfiniteVector in parallel, its support has to be
+ split into pieces of roughly equal size. For a std::map based vector, this
+ has so far been done by copying all indices into a std::vector, which costs
+ O(N) time and memory before any parallel work can start.
+
+ In this design test program, we work out a splittable range abstraction
+ SplittableRange<CONTAINER>, modelled after the Range concept of the usual
+ work-stealing schedulers (e.g., TBB): a range can tell whether it is empty()
+ or is_divisible(), and split() cuts off (and returns) its upper half.
+ No index is copied; the halves are determined from the structure of CONTAINER:
+ 1) Flat containers with random access iterators (like FlatMap below) are
+    split at the middle offset, in O(1).
+ 2) std::map is split at the midpoint of the first and the last key, which is
+    located with lower_bound() in O(log N). This is the portable analogue of
+    descending to the root of a subtree, and it gives roughly equal halves
+    as long as the keys are distributed evenly. Since the halves may then
+    have any size, is_divisible() counts at most grainsize+1 entries. The
+    midpoint is only meaningful for arithmetic keys ordered by std::less or
+    std::greater; otherwise, the range falls back to std::next() with the
+    (exact) number of entries, which costs O(N) steps but still no memory.
+ 3) std::unordered_map is split into ranges of buckets, which are traversed
+    with the local iterators of the buckets.
+ As a minimal scheduler, parallel_reduce() below recursively splits a range
+ and hands the upper halves to std::async, down to a given depth.
+ */
+
+using std::cout;
+using std::endl;
+
+/*
+ A flat associative container: a std::vector of (index,value) pairs, sorted by
+ the index. Lookups are O(log N) by binary search, inserting a new index costs
+ O(N), but the iterators are contiguous.
+ */
+template <class I, class C>
+class FlatMap
+  : protected std::vector<std::pair<I,C> >
+{
+public:
+  typedef std::vector<std::pair<I,C> > Base;
+  typedef I key_type;
+  typedef C mapped_type;
+  typedef typename Base::value_type value_type;
+  typedef typename Base::iterator iterator;
+  typedef typename Base::const_iterator const_iterator;
+
+  using Base::begin;
+  using Base::end;
+  using Base::size;
+  using Base::empty;
+
+  C& operator [] (const I& index)
+  {
+    iterator it(std::lower_bound(begin(), end(), index,
+                                 [] (const value_type& entry, const I& i) { return entry.first < i; }));
+    if (it == end() || it->first != index)
+      it = Base::insert(it, value_type(index, C()));
+    return it->second;
+  }
+};
+
+// flat containers with random access iterators: split at the middle offset
+template <class CONTAINER>
+class SplittableRange
+{
+public:
+  typedef typename CONTAINER::const_iterator const_iterator;
+
+  SplittableRange(const CONTAINER& container, const size_t grainsize)
+  : _first(container.begin()), _last(container.end()), _grainsize(grainsize)
+  {
+  }
+
+  bool empty() const
+  {
+    return _first == _last;
+  }
+
+  size_t size() const
+  {
+    return _last - _first;
+  }
+
+  bool is_divisible() const
+  {
+    return size() > _grainsize;
+  }
+
+  SplittableRange<CONTAINER> split()
+  {
+    SplittableRange<CONTAINER> upper(*this);
+    upper._first = _last = _first + size()/2;
+    return upper;
+  }
+
+  template <class FUNCTION>
+  void for_each(FUNCTION f) const
+  {
+    for (const_iterator it(_first); it != _last; ++it)
+      f(it->first, it->second);
+  }
+
+private:
+  const_iterator _first, _last;
+  size_t _grainsize;
+};
+
+// std::map: split at the midpoint of the keys, if they are ordered numerically
+template <class K, class C, class COMPARE, class ALLOCATOR>
+class SplittableRange<std::map<K,C,COMPARE,ALLOCATOR> >
+{
+public:
+  typedef std::map<K,C,COMPARE,ALLOCATOR> Container;
+  typedef typename Container::const_iterator const_iterator;
+
+  // the midpoint of two keys lies between them only in the numerical order
+  static constexpr bool split_at_midpoint =
+    std::is_arithmetic_v<K>
+    && (std::is_same_v<COMPARE, std::less<K> > || std::is_same_v<COMPARE, std::greater<K> >);
+
+  SplittableRange(const Container& container, const size_t grainsize)
+  : _container(&container), _first(container.begin()), _last(container.end()),
+    _size(container.size()), _grainsize(grainsize)
+  {
+  }
+
+  bool empty() const
+  {
+    return _first == _last;
+  }
+
+  // the number of entries; O(N) after splits at the midpoint of the keys
+  size_t size() const
+  {
+    if constexpr (split_at_midpoint)
+      return std::distance(_first, _last);
+    else
+      return _size;
+  }
+
+  bool is_divisible() const
+  {
+    if constexpr (split_at_midpoint)
+    {
+      // the halves may have any size, so count at most _grainsize+1 entries
+      const_iterator it(_first);
+      for (size_t n = 0; n <= _grainsize && it != _last; n++)
+        ++it;
+      return it != _last && std::next(_first) != _last;
+    }
+    else
+      return _size > _grainsize && std::next(_first) != _last;
+  }
+
+  SplittableRange<Container> split()
+  {
+    SplittableRange<Container> upper(*this);
+    const_iterator middle;
+    if constexpr (split_at_midpoint)
+    {
+      // the midpoint lies between the first and the last key of this range, so
+      // that middle is in (_first,_last) after skipping over the first entry
+      middle = _container->lower_bound(std::midpoint(_first->first, std::prev(_last)->first));
+      if (middle == _first)
+        ++middle;
+    }
+    else
+    {
+      middle = std::next(_first, _size/2);
+      upper._size = _size - _size/2;
+      _size /= 2;
+    }
+    upper._first = _last = middle;
+    return upper;
+  }
+
+  template <class FUNCTION>
+  void for_each(FUNCTION f) const
+  {
+    for (const_iterator it(_first); it != _last; ++it)
+      f(it->first, it->second);
+  }
+
+private:
+  const Container* _container;
+  const_iterator _first, _last;
+  size_t _size, _grainsize; // _size is only used for splits by count
+};
+
+// std::unordered_map: split into ranges of buckets
+template <class K, class C, class HASH, class EQUAL, class ALLOCATOR>
+class SplittableRange<std::unordered_map<K,C,HASH,EQUAL,ALLOCATOR> >
+{
+public:
+  typedef std::unordered_map<K,C,HASH,EQUAL,ALLOCATOR> Container;
+  typedef typename Container::const_local_iterator const_local_iterator;
+
+  SplittableRange(const Container& container, const size_t grainsize)
+  : _container(&container), _first(0), _last(container.bucket_count()), _grainsize(grainsize)
+  {
+  }
+
+  bool empty() const
+  {
+    return _first == _last;
+  }
+
+  // the expected number of entries in the buckets of this range
+  size_t size() const
+  {
+    return _container->size() * (_last-_first) / _container->bucket_count();
+  }
+
+  bool is_divisible() const
+  {
+    return _last-_first > 1 && size() > _grainsize;
+  }
+
+  SplittableRange<Container> split()
+  {
+    SplittableRange<Container> upper(*this);
+    upper._first = _last = _first + (_last-_first)/2;
+    return upper;
+  }
+
+  template <class FUNCTION>
+  void for_each(FUNCTION f) const
+  {
+    for (size_t b = _first; b < _last; b++)
+      for (const_local_iterator it(_container->begin(b)); it != _container->end(b); ++it)
+        f(it->first, it->second);
+  }
+
+private:
+  const Container* _container;
+  size_t _first, _last; // range of buckets
+  size_t _grainsize;
+};
+
+template <class C, class I=int, class CONTAINER=std::map<I,C> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  void set_coefficient(const I& index, const C value)
+  {
+    CONTAINER::operator [] (index) = value;
+  }
+
+  // the whole support as a splittable range, which is not divided below grainsize entries
+  SplittableRange<CONTAINER> splittable_range(const size_t grainsize = 1024) const
+  {
+    return SplittableRange<CONTAINER>(*this, grainsize);
+  }
+};
+
+/*
+ Reduce f(index,value) over a splittable range with the binary operation
+ combine, splitting recursively and running the upper halves asynchronously,
+ up to the given depth. The sizes of the leaf ranges are collected in leaves,
+ if requested.
+ */
+template <class RANGE, class T, class FUNCTION, class COMBINE>
+T parallel_reduce(RANGE range, const T identity, FUNCTION f, COMBINE combine,
+                  const unsigned int depth, std::vector<size_t>* leaves = nullptr)
+{
+  if (depth > 0 && range.is_divisible())
+  {
+    RANGE upper(range.split());
+    std::vector<size_t> upper_leaves;
+    std::future<T> r
+      (std::async(std::launch::async, [&] ()
+                  { return parallel_reduce(upper, identity, f, combine, depth-1,
+                                           leaves ? &upper_leaves : nullptr); }));
+    const T l(parallel_reduce(range, identity, f, combine, depth-1, leaves));
+    const T u(r.get());
+    if (leaves)
+      leaves->insert(leaves->end(), upper_leaves.begin(), upper_leaves.end());
+    return combine(l, u);
+  }
+
+  T r(identity);
+  size_t n(0);
+  range.for_each([&] (const auto& index, const auto& value) { r = combine(r, f(index, value)); n++; });
+  if (leaves)
+    leaves->push_back(n);
+  return r;
+}
+
+template <class VECTOR>
+void test_reduction(const char* name, const VECTOR& v, const double expected)
+{
+  std::vector<size_t> leaves;
+  const double sum
+    = parallel_reduce(v.splittable_range(), 0.0,
+                      [] (const auto&, const double value) { return value; },
+                      [] (const double a, const double b) { return a+b; },
+                      3, &leaves);
+  cout << "- " << name << ": parallel sum " << sum
+    << (sum == expected ? " (correct)" : " (wrong)") << ", leaf sizes:";
+  for (size_t k = 0; k < leaves.size(); k++)
+    cout << " " << leaves[k];
+  cout << endl;
+}
+
+int main()
+{
+  const int N=100000;
+  InfiniteVector<double,int> v;
+  InfiniteVector<double,int,std::unordered_map<int,double> > u;
+  InfiniteVector<double,int,FlatMap<int,double> > f;
+  InfiniteVector<double,std::pair<int,int> > p; // non-arithmetic keys
+  InfiniteVector<double,long> q; // unevenly distributed keys
+  InfiniteVector<double,int,std::map<int,double,std::greater<int> > > g; // descending order
+  double expected=0;
+  for (int i=0; i<N; i++)
+    if (i%3 != 0)
+    {
+      const double value=1.0+(i%10);
+      v.set_coefficient(3*i, value);
+      u.set_coefficient(3*i, value);
+      f.set_coefficient(3*i, value);
+      p.set_coefficient(std::make_pair(i%100, i/100), value);
+      q.set_coefficient(long(i)*i*i, value);
+      g.set_coefficient(3*i, value);
+      expected += value;
+    }
+  cout << "- sequential sum of " << v.size() << " entries: " << expected << endl;
+
+  test_reduction("std::map", v, expected);
+  test_reduction("std::unordered_map", u, expected);
+  test_reduction("FlatMap", f, expected);
+  test_reduction("std::map with pairs as keys", p, expected);
+  test_reduction("std::map with cubic keys", q, expected);
+  test_reduction("std::map with std::greater", g, expected);
+
+  return 0;
+}
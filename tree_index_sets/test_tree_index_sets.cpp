@@ -0,0 +1,354 @@
+#include <iostream>
+#include <set>
+#include <unordered_set>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <cstdint>
+#include <time.h>
+#include <math.h>
+#include "wavelet_index/wavelet_index.h"
+
+/*
+ Adaptive wavelet algorithms work with index sets Lambda which are trees, i.e.,
+ the parent of every index lambda in Lambda above the coarsest level j0 is
+ contained in Lambda as well. After a refinement step, Lambda usually has to
+ be completed to the smallest tree containing it, and the leaves of the tree
+ are needed for the next refinement decision.
+ With std::set (or std::map) of indices, every step up the tree is a search
+ in a balanced tree, i.e., O(log(#Lambda)) comparisons and cache misses.
+
+ In this design test program, we store the 64-bit words of WaveletIndex
+ objects (see wavelet_index/wavelet_index.h) in a hash table with open
+ addressing, linear probing and a power-of-two capacity, so that
+ 1) contains(), insert() and the navigation to the parent (computed from the
+    word with a few shifts and masks) cost O(1) on average;
+ 2) complete() walks up from every index and stops at the first ancestor
+    which is already present, so that every index of the closure is
+    inserted only once;
+ 3) leaves() marks the parents of all indices in one sweep over the table,
+    instead of searching for all 2^D children of every index;
+ 4) contains_parents() answers the parent queries for a batch of indices in
+    blocks: first the parents and their hash values are computed in loops
+    without branches, and the table slots are prefetched, then the probing
+    is done.
+ We compare these operations with std::set and std::unordered_set.
+ */
+
+using std::cout;
+using std::endl;
+
+template <class INDEX>
+class TreeIndexSet
+{
+public:
+  explicit TreeIndexSet(const int j0 = 0)
+  : j0_(j0), size_(0), slots_(16, empty)
+  {
+  }
+
+  int coarsest_level() const
+  {
+    return j0_;
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  bool contains(const INDEX& lambda) const
+  {
+    return slots_[find_slot(lambda.word())] == lambda.word();
+  }
+
+  // insert lambda, return whether it was new
+  bool insert(const INDEX& lambda)
+  {
+    if (2*(size_+1) > slots_.size())
+      grow();
+    const size_t slot(find_slot(lambda.word()));
+    if (slots_[slot] == lambda.word())
+      return false;
+    slots_[slot] = lambda.word();
+    size_++;
+    return true;
+  }
+
+  // add all ancestors on the levels j0,...,j-1 of all indices
+  void complete()
+  {
+    const std::vector<uint64_t> words(occupied_words());
+    for (size_t i = 0; i < words.size(); i++)
+    {
+      INDEX lambda(INDEX::from_word(words[i]));
+      while (lambda.j() > j0_)
+      {
+        lambda = lambda.parent();
+        // if lambda is present, its ancestors need not be yet, but they are
+        // added by the walk from lambda: either lambda was inserted by an
+        // earlier walk, which went on upwards, or it is one of the original
+        // indices, from each of which the loop walks up anyway
+        if (!insert(lambda))
+          break;
+      }
+    }
+  }
+
+  bool is_tree() const
+  {
+    for (size_t slot = 0; slot < slots_.size(); slot++)
+      if (slots_[slot] != empty)
+      {
+        const INDEX lambda(INDEX::from_word(slots_[slot]));
+        if (lambda.j() > j0_ && !contains(lambda.parent()))
+          return false;
+      }
+    return true;
+  }
+
+  // all indices without a child in the set, sorted
+  std::vector<INDEX> leaves() const
+  {
+    std::vector<char> has_child(slots_.size(), 0);
+    for (size_t slot = 0; slot < slots_.size(); slot++)
+      if (slots_[slot] != empty)
+      {
+        const INDEX lambda(INDEX::from_word(slots_[slot]));
+        if (lambda.j() > j0_)
+        {
+          const size_t parent_slot(find_slot(lambda.parent().word()));
+          if (slots_[parent_slot] != empty)
+            has_child[parent_slot] = 1;
+        }
+      }
+    std::vector<INDEX> r;
+    for (size_t slot = 0; slot < slots_.size(); slot++)
+      if (slots_[slot] != empty && !has_child[slot])
+        r.push_back(INDEX::from_word(slots_[slot]));
+    std::sort(r.begin(), r.end());
+    return r;
+  }
+
+  // all indices, sorted
+  std::vector<INDEX> indices() const
+  {
+    std::vector<INDEX> r;
+    r.reserve(size_);
+    for (size_t slot = 0; slot < slots_.size(); slot++)
+      if (slots_[slot] != empty)
+        r.push_back(INDEX::from_word(slots_[slot]));
+    std::sort(r.begin(), r.end());
+    return r;
+  }
+
+  // result[i] = whether the parent of batch[i] is present (true on the level j0)
+  void contains_parents(std::span<const INDEX> batch, std::span<char> result) const
+  {
+    const size_t B(256);
+    uint64_t parents[B];
+    size_t slots[B];
+    const size_t mask(slots_.size()-1);
+    for (size_t start = 0; start < batch.size(); start += B)
+    {
+      const size_t length(std::min(B, batch.size()-start));
+      for (size_t i = 0; i < length; i++)
+      {
+        const INDEX& lambda(batch[start+i]);
+        parents[i] = (lambda.j() > j0_ ? lambda.parent().word() : empty);
+        slots[i] = std::hash<INDEX>()(INDEX::from_word(parents[i])) & mask;
+      }
+      for (size_t i = 0; i < length; i++)
+        __builtin_prefetch(&slots_[slots[i]]);
+      for (size_t i = 0; i < length; i++)
+      {
+        if (parents[i] == empty)
+        {
+          result[start+i] = 1;
+          continue;
+        }
+        size_t slot(slots[i]);
+        while (slots_[slot] != empty && slots_[slot] != parents[i])
+          slot = (slot+1) & mask;
+        result[start+i] = (slots_[slot] == parents[i]);
+      }
+    }
+  }
+
+private:
+  // the level field of ~0 exceeds max_level, so that it is no valid word
+  static constexpr uint64_t empty = ~uint64_t(0);
+
+  // the slot which contains word, or the empty slot where it would be inserted
+  size_t find_slot(const uint64_t word) const
+  {
+    const size_t mask(slots_.size()-1);
+    size_t slot(std::hash<INDEX>()(INDEX::from_word(word)) & mask);
+    while (slots_[slot] != empty && slots_[slot] != word)
+      slot = (slot+1) & mask;
+    return slot;
+  }
+
+  std::vector<uint64_t> occupied_words() const
+  {
+    std::vector<uint64_t> r;
+    r.reserve(size_);
+    for (size_t slot = 0; slot < slots_.size(); slot++)
+      if (slots_[slot] != empty)
+        r.push_back(slots_[slot]);
+    return r;
+  }
+
+  void grow()
+  {
+    const std::vector<uint64_t> words(occupied_words());
+    slots_.assign(2*slots_.size(), empty);
+    for (size_t i = 0; i < words.size(); i++)
+      slots_[find_slot(words[i])] = words[i];
+  }
+
+  int j0_;
+  size_t size_;
+  std::vector<uint64_t> slots_;
+};
+
+typedef WaveletIndex<2> Index;
+
+// the same operations with per-element searches, for comparison
+template <class SET>
+void complete(SET& lambdas)
+{
+  const std::vector<Index> indices(lambdas.begin(), lambdas.end());
+  for (size_t i=0; i<indices.size(); i++)
+  {
+    Index lambda(indices[i]);
+    while (lambda.j() > 0)
+    {
+      lambda = lambda.parent();
+      if (!lambdas.insert(lambda).second)
+        break;
+    }
+  }
+}
+
+template <class SET>
+std::vector<Index> leaves(const SET& lambdas)
+{
+  std::vector<Index> r;
+  for (typename SET::const_iterator it(lambdas.begin()); it != lambdas.end(); ++it)
+  {
+    bool leaf(true);
+    for (unsigned int c=0; c<4 && leaf; c++)
+      leaf = (lambdas.find(it->child(c)) == lambdas.end());
+    if (leaf)
+      r.push_back(*it);
+  }
+  std::sort(r.begin(), r.end());
+  return r;
+}
+
+template <class SET>
+void contains_parents(const SET& lambdas, std::span<const Index> batch, std::span<char> result)
+{
+  for (size_t i=0; i<batch.size(); i++)
+    result[i] = (batch[i].j() == 0 || lambdas.find(batch[i].parent()) != lambdas.end());
+}
+
+int main()
+{
+  // the wavelets on the levels J-2,...,J whose supports meet the circle |x-(1/2,1/2)|=0.4
+  const int J=14;
+  std::vector<Index> refinement;
+  for (int j=J-2; j<=J; j++)
+  {
+    const double h(ldexp(1.0, -j));
+    const int steps(int(8*M_PI*0.4/h));
+    for (int s=0; s<steps; s++)
+    {
+      const double phi(2*M_PI*s/steps);
+      const uint64_t k0(floor((0.5+0.4*cos(phi))/h)), k1(floor((0.5+0.4*sin(phi))/h));
+      for (unsigned int e=1; e<4; e++)
+        refinement.push_back(Index(j, e, {k0, k1}));
+    }
+  }
+
+  TreeIndexSet<Index> tree;
+  std::set<Index> set;
+  std::unordered_set<Index> unordered_set;
+  for (size_t i=0; i<refinement.size(); i++)
+  {
+    tree.insert(refinement[i]);
+    set.insert(refinement[i]);
+    unordered_set.insert(refinement[i]);
+  }
+  cout << "- " << tree.size() << " indices before the completion, is it a tree? "
+    << (tree.is_tree() ? "yes" : "no") << endl;
+
+  clock_t start=clock();
+  tree.complete();
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  complete(set);
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  complete(unordered_set);
+  const double dur3=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  const std::vector<Index> completed(tree.indices());
+  std::vector<Index> completed_unordered(unordered_set.begin(), unordered_set.end());
+  std::sort(completed_unordered.begin(), completed_unordered.end());
+  cout << "- " << tree.size() << " indices after the completion, is it a tree? "
+    << (tree.is_tree() ? "yes" : "no") << endl;
+  cout << "- do all completions agree? "
+    << (std::equal(completed.begin(), completed.end(), set.begin(), set.end())
+        && completed == completed_unordered ? "yes" : "no") << endl;
+
+  start=clock();
+  const std::vector<Index> leaves1(tree.leaves());
+  const double dur4=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  const std::vector<Index> leaves2(leaves(set));
+  const double dur5=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  const std::vector<Index> leaves3(leaves(unordered_set));
+  const double dur6=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << "- do the " << leaves1.size() << " leaves agree? "
+    << (leaves1 == leaves2 && leaves1 == leaves3 ? "yes" : "no") << endl;
+
+  // parent queries for the children of all leaves, as after a refinement step
+  std::vector<Index> batch;
+  for (size_t i=0; i<leaves1.size(); i++)
+    for (unsigned int c=0; c<4; c++)
+      batch.push_back(leaves1[i].child(c));
+  for (size_t i=0; i<refinement.size(); i++)
+    if (refinement[i].j() > 2)
+      batch.push_back(refinement[i].parent().parent().child(3).child(3));
+  std::vector<char> result1(batch.size()), result2(batch.size()), result3(batch.size());
+  const int repetitions=3;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    tree.contains_parents(batch, result1);
+  const double dur7=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    contains_parents(set, batch, result2);
+  const double dur8=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (int r=0; r<repetitions; r++)
+    contains_parents(unordered_set, batch, result3);
+  const double dur9=(clock() - start) / (double) CLOCKS_PER_SEC;
+  cout << "- do the parent queries for " << batch.size() << " indices agree? "
+    << (result1 == result2 && result1 == result3 ? "yes" : "no") << endl;
+
+  cout << "\ncompletion with TreeIndexSet: " << dur1 << "s\n";
+  cout << "completion with std::set: " << dur2 << "s\n";
+  cout << "completion with std::unordered_set: " << dur3 << "s\n";
+  cout << "\nleaves with TreeIndexSet: " << dur4 << "s\n";
+  cout << "leaves with std::set: " << dur5 << "s\n";
+  cout << "leaves with std::unordered_set: " << dur6 << "s\n";
+  cout << "\nparent queries with TreeIndexSet: " << dur7 << "s\n";
+  cout << "parent queries with std::set: " << dur8 << "s\n";
+  cout << "parent queries with std::unordered_set: " << dur9 << "s\n";
+
+  return 0;
+}
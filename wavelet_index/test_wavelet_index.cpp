@@ -0,0 +1,202 @@
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <tuple>
+#include <cstdint>
+#include <time.h>
+#include <math.h>
+#include "wavelet_index/wavelet_index.h"
+
+/*
+ Wavelet indices lambda=(j,e,k) consist of a level j, a type e in {0,1}^D
+ (generator or wavelet in each direction) and a translation k in Z^D. The
+ Key classes from map_tuple_keys store every component in a full int, and
+ their comparison objects compare the components one after the other.
+
+ In this design test program, we pack (j,e,k) for nonnegative translations
+ 0<=k_i<2^j into a single 64-bit word, with a layout chosen at compile time:
+   [ j: LEVELBITS | e_0...e_{D-1}: D | k_0: T | k_1: T | ... | k_{D-1}: T ],
+ where T=(64-LEVELBITS-D)/D is the number of bits per translation. Then
+ 1) comparing two WaveletIndex objects is a single integer comparison, which
+    sorts by level, then by type (generators first), then lexicographically
+    by translation, as the Key_Compare objects do;
+ 2) the dyadic parent (j-1,e,floor(k/2)) and the children (j+1,e,2k+c),
+    c in {0,1}^D, are computed for all directions at once, by shifting the
+    translation fields and masking the bits which cross the field borders;
+ 3) the neighbour k+delta*e_i in direction i is an addition to the word;
+ 4) std::hash<WaveletIndex> mixes the word, so that WaveletIndex can be used
+    in power-of-two hash tables as well (see map_tuple_keys/test_map_hash.cpp).
+ WaveletIndex itself lives in wavelet_index.h, so that other design tests can
+ include it. It can be used as the index type I of InfiniteVector with
+ std::map<I,C> (the default) or std::unordered_map<I,C>, without a custom
+ comparison object.
+ */
+
+using std::cout;
+using std::endl;
+
+// the layouts for D=1,2,3
+static_assert(sizeof(WaveletIndex<3>) == sizeof(uint64_t));
+static_assert(WaveletIndex<1>::translation_bits == 57 && WaveletIndex<1>::max_level == 56);
+static_assert(WaveletIndex<2>::translation_bits == 28 && WaveletIndex<2>::max_level == 27);
+static_assert(WaveletIndex<3>::translation_bits == 18 && WaveletIndex<3>::max_level == 17);
+static_assert(WaveletIndex<2>(3, 2, {5, 7}).k(1) == 7 && WaveletIndex<2>(3, 2, {5, 7}).e() == 2);
+static_assert(WaveletIndex<2>(3, 2, {5, 7}).child(3) == WaveletIndex<2>(4, 2, {11, 15}));
+static_assert(WaveletIndex<2>(3, 2, {5, 7}).parent() == WaveletIndex<2>(2, 2, {2, 3}));
+static_assert(WaveletIndex<2>(1, 0, {1, 1}) < WaveletIndex<2>(2, 0, {0, 0}));
+
+// for comparison: all components in full ints, compared one after the other
+template <unsigned int D>
+struct StructIndex
+{
+  int j;
+  unsigned int e;
+  std::array<int,D> k;
+};
+
+template <unsigned int D>
+struct StructIndex_Compare
+{
+  bool operator() (const StructIndex<D>& lhs, const StructIndex<D>& rhs) const
+  {
+    return std::tie(lhs.j, lhs.e, lhs.k) < std::tie(rhs.j, rhs.e, rhs.k);
+  }
+};
+
+template <class C, class I, class CONTAINER=std::map<I,C> >
+class InfiniteVector
+  : protected CONTAINER
+{
+public:
+  typedef typename CONTAINER::const_iterator const_iterator;
+
+  const_iterator begin() const
+  {
+    return CONTAINER::begin();
+  }
+
+  const_iterator end() const
+  {
+    return CONTAINER::end();
+  }
+
+  size_t size() const
+  {
+    return CONTAINER::size();
+  }
+
+  C get_coefficient(const I& index) const
+  {
+    const_iterator it(CONTAINER::find(index));
+    return (it == CONTAINER::end() ? C(0) : it->second);
+  }
+
+  void set_coefficient(const I& index, const C value)
+  {
+    CONTAINER::operator [] (index) = value;
+  }
+};
+
+int main()
+{
+  typedef WaveletIndex<2> Index;
+  const int J=8;
+
+  // all indices (j,e,k) with j<=J, in D=2 dimensions
+  std::vector<Index> indices;
+  std::vector<StructIndex<2> > struct_indices;
+  for (int j=0; j<=J; j++)
+    for (unsigned int e=0; e<4; e++)
+      for (uint64_t k0=0; k0<(1u<<j); k0++)
+        for (uint64_t k1=0; k1<(1u<<j); k1++)
+        {
+          indices.push_back(Index(j, e, {k0, k1}));
+          struct_indices.push_back(StructIndex<2>{j, e, {int(k0), int(k1)}});
+        }
+
+  bool ok(true);
+  for (size_t i=0; i<indices.size(); i++)
+    ok = ok && indices[i].j() == struct_indices[i].j && indices[i].e() == struct_indices[i].e
+      && int(indices[i].k(0)) == struct_indices[i].k[0] && int(indices[i].k(1)) == struct_indices[i].k[1];
+  cout << "- does WaveletIndex store (j,e,k) exactly? " << (ok ? "yes" : "no") << endl;
+
+  // the generation loop above is already sorted by level, type and translation
+  cout << "- does the word order agree with the lexicographical order of (j,e,k)? "
+    << (std::is_sorted(indices.begin(), indices.end())
+        && std::is_sorted(struct_indices.begin(), struct_indices.end(), StructIndex_Compare<2>()) ? "yes" : "no")
+    << endl;
+
+  ok = true;
+  for (size_t i=0; i<indices.size(); i++)
+  {
+    const Index& lambda(indices[i]);
+    for (unsigned int c=0; c<4; c++)
+      ok = ok && lambda.child(c).parent() == lambda
+        && lambda.child(c) == Index(lambda.j()+1, lambda.e(), {2*lambda.k(0)+(c & 1), 2*lambda.k(1)+(c >> 1)});
+    if (lambda.j() > 0)
+      ok = ok && lambda.parent() == Index(lambda.j()-1, lambda.e(), {lambda.k(0)/2, lambda.k(1)/2});
+    for (unsigned int d=0; d<2; d++)
+      for (int delta=-1; delta<=1; delta+=2)
+        if (lambda.has_neighbour(d, delta))
+          ok = ok && lambda.neighbour(d, delta).neighbour(d, -delta) == lambda
+            && int(lambda.neighbour(d, delta).k(d)) == int(lambda.k(d))+delta
+            && lambda.neighbour(d, delta).k(1-d) == lambda.k(1-d);
+  }
+  cout << "- are parent(), child() and neighbour() consistent? " << (ok ? "yes" : "no") << endl;
+
+  cout << "- sizes of the index types: WaveletIndex<2> " << sizeof(Index)
+    << " bytes, StructIndex<2> " << sizeof(StructIndex<2>) << " bytes" << endl;
+
+  // InfiniteVector with WaveletIndex, and with the struct for comparison
+  InfiniteVector<double,Index> v;
+  InfiniteVector<double,Index,std::unordered_map<Index,double> > u;
+  InfiniteVector<double,StructIndex<2>,std::map<StructIndex<2>,double,StructIndex_Compare<2> > > w;
+
+  clock_t start=clock();
+  for (size_t i=0; i<indices.size(); i++)
+    v.set_coefficient(indices[i], 1.0/(1+indices[i].j()));
+  const double dur1=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (size_t i=0; i<struct_indices.size(); i++)
+    w.set_coefficient(struct_indices[i], 1.0/(1+struct_indices[i].j));
+  const double dur2=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (size_t i=0; i<indices.size(); i++)
+    u.set_coefficient(indices[i], 1.0/(1+indices[i].j()));
+  const double dur3=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  // a tree traversal: add the coefficient of the parent to every entry
+  double r1=0, r2=0, r3=0;
+  start=clock();
+  for (size_t i=0; i<indices.size(); i++)
+    if (indices[i].j() > 0)
+      r1 += v.get_coefficient(indices[i].parent());
+  const double dur4=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (size_t i=0; i<struct_indices.size(); i++)
+  {
+    const StructIndex<2>& lambda(struct_indices[i]);
+    if (lambda.j > 0)
+      r2 += w.get_coefficient(StructIndex<2>{lambda.j-1, lambda.e, {lambda.k[0]/2, lambda.k[1]/2}});
+  }
+  const double dur5=(clock() - start) / (double) CLOCKS_PER_SEC;
+  start=clock();
+  for (size_t i=0; i<indices.size(); i++)
+    if (indices[i].j() > 0)
+      r3 += u.get_coefficient(indices[i].parent());
+  const double dur6=(clock() - start) / (double) CLOCKS_PER_SEC;
+
+  cout << "- do the parent sums agree? " << (r1 == r2 && r1 == r3 && r1 > 0 ? "yes" : "no") << endl;
+
+  cout << "\nwriting " << indices.size() << " entries with WaveletIndex into std::map: " << dur1 << "s\n";
+  cout << "writing with StructIndex into std::map: " << dur2 << "s\n";
+  cout << "writing with WaveletIndex into std::unordered_map: " << dur3 << "s\n";
+  cout << "\nreading the parents with WaveletIndex from std::map: " << dur4 << "s\n";
+  cout << "reading the parents with StructIndex from std::map: " << dur5 << "s\n";
+  cout << "reading the parents with WaveletIndex from std::unordered_map: " << dur6 << "s\n";
+
+  return 0;
+}
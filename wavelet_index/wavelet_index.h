@@ -0,0 +1,172 @@
+// -*- c++ -*-
+
+#ifndef _AMSTEL_WAVELET_INDEX_H
+#define _AMSTEL_WAVELET_INDEX_H
+
+#include <array>
+#include <algorithm>
+#include <compare>
+#include <functional>
+#include <cstdint>
+#include <cassert>
+#include "map_tuple_keys/hash_mix.h"
+
+/*
+ WaveletIndex<D,LEVELBITS> packs a wavelet index lambda=(j,e,k), with level j,
+ type e in {0,1}^D and nonnegative translations 0<=k_i<2^j, into a single
+ 64-bit word
+   [ j: LEVELBITS | e_0...e_{D-1}: D | k_0: T | k_1: T | ... | k_{D-1}: T ],
+ T=(64-LEVELBITS-D)/D, so that comparisons are integer comparisons and the
+ dyadic parent, children and neighbours are computed with a few shifts,
+ masks and additions (see test_wavelet_index.cpp).
+ */
+
+template <unsigned int D, unsigned int LEVELBITS=6>
+class WaveletIndex
+{
+public:
+  static_assert(D >= 1 && LEVELBITS >= 1 && LEVELBITS+D < 64, "invalid layout");
+
+  // the layout of the word
+  static constexpr unsigned int translation_bits = (64-LEVELBITS-D)/D;
+  static constexpr unsigned int type_shift = D*translation_bits;
+  static constexpr unsigned int level_shift = type_shift+D;
+
+  // the largest admissible level, keeping the highest bit of every translation field free
+  static constexpr int max_level = std::min((1 << LEVELBITS)-1, int(translation_bits)-1);
+
+  typedef std::array<uint64_t,D> translation_type;
+
+  constexpr WaveletIndex()
+  : word_(0)
+  {
+  }
+
+  constexpr WaveletIndex(const int j, const unsigned int e, const translation_type& k)
+  : word_((uint64_t(j) << level_shift) | (uint64_t(e) << type_shift))
+  {
+    assert(0 <= j && j <= max_level && e < (1u << D));
+    for (unsigned int i = 0; i < D; i++)
+    {
+      assert(k[i] < (uint64_t(1) << j));
+      word_ |= k[i] << translation_shift(i);
+    }
+  }
+
+  static constexpr WaveletIndex from_word(const uint64_t word)
+  {
+    WaveletIndex r;
+    r.word_ = word;
+    return r;
+  }
+
+  constexpr uint64_t word() const
+  {
+    return word_;
+  }
+
+  constexpr int j() const
+  {
+    return word_ >> level_shift;
+  }
+
+  constexpr unsigned int e() const
+  {
+    return (word_ >> type_shift) & ((1u << D)-1);
+  }
+
+  constexpr uint64_t k(const unsigned int i) const
+  {
+    return (word_ >> translation_shift(i)) & field_mask;
+  }
+
+  constexpr translation_type k() const
+  {
+    translation_type r{};
+    for (unsigned int i = 0; i < D; i++)
+      r[i] = k(i);
+    return r;
+  }
+
+  constexpr auto operator <=> (const WaveletIndex&) const = default;
+
+  // (j-1,e,floor(k/2)), for j>0
+  constexpr WaveletIndex parent() const
+  {
+    assert(j() > 0);
+    return from_word(((word_ - level_one) & ~translation_mask)
+                     | (((word_ & translation_mask) >> 1) & ~high_bits));
+  }
+
+  // (j+1,e,2k+c), where bit i of c is the offset in direction i, for j<max_level
+  constexpr WaveletIndex child(const unsigned int c) const
+  {
+    assert(j() < max_level && c < (1u << D));
+    return from_word(((word_ + level_one) & ~translation_mask)
+                     + ((word_ & translation_mask) << 1) + child_offsets[c]);
+  }
+
+  // whether k+delta*e_i is a valid translation on level j
+  constexpr bool has_neighbour(const unsigned int i, const int delta) const
+  {
+    const int64_t ki(k(i) + int64_t(delta));
+    return ki >= 0 && ki < (int64_t(1) << j());
+  }
+
+  // (j,e,k+delta*e_i), if has_neighbour(i,delta)
+  constexpr WaveletIndex neighbour(const unsigned int i, const int delta) const
+  {
+    assert(has_neighbour(i, delta));
+    return from_word(word_ + (uint64_t(int64_t(delta)) << translation_shift(i)));
+  }
+
+private:
+  static constexpr unsigned int translation_shift(const unsigned int i)
+  {
+    return (D-1-i)*translation_bits;
+  }
+
+  static constexpr uint64_t level_one = uint64_t(1) << level_shift;
+  static constexpr uint64_t field_mask = (uint64_t(1) << translation_bits)-1;
+  static constexpr uint64_t translation_mask = (uint64_t(1) << type_shift)-1;
+
+  // the bit at position bit of every translation field
+  static constexpr uint64_t field_bits(const unsigned int bit)
+  {
+    uint64_t r(0);
+    for (unsigned int i = 0; i < D; i++)
+      r |= uint64_t(1) << (translation_shift(i)+bit);
+    return r;
+  }
+
+  static constexpr uint64_t high_bits = field_bits(translation_bits-1);
+
+  // the offsets of the children, bit i of c selecting the lowest bit of the field i
+  static constexpr std::array<uint64_t,(1u << D)> compute_child_offsets()
+  {
+    std::array<uint64_t,(1u << D)> r{};
+    for (unsigned int c = 0; c < (1u << D); c++)
+      for (unsigned int i = 0; i < D; i++)
+        if (c & (1u << i))
+          r[c] |= uint64_t(1) << translation_shift(i);
+    return r;
+  }
+
+  static constexpr std::array<uint64_t,(1u << D)> child_offsets = compute_child_offsets();
+
+  uint64_t word_;
+};
+
+namespace std
+{
+  template <unsigned int D, unsigned int LEVELBITS>
+  struct hash<WaveletIndex<D,LEVELBITS> >
+  {
+    size_t operator() (const WaveletIndex<D,LEVELBITS>& lambda) const
+    {
+      return hash_mix(lambda.word());
+    }
+  };
+}
+
+#endif